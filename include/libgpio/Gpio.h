@@ -25,91 +25,256 @@
 #ifndef com_github_cfriedt_Gpio_h_
 #define com_github_cfriedt_Gpio_h_
 
+#include <chrono>
+#include <system_error>
+#include <vector>
+
 #include "libgpio/libgpio.h"
 
 namespace com {
 namespace github {
 namespace cfriedt {
 
+/**
+ * @brief A change of level observed on a GPIO
+ */
+struct GpioEvent {
+	/** the GPIO number */
+	uint16_t num;
+	/** the level after the change */
+	gpio_value_t value;
+	/** GPIO_EDGE_RISING or GPIO_EDGE_FALLING */
+	gpio_edge_t edge;
+	/**
+	 * when userspace woke up for the change, not when the edge happened;
+	 * it trails the edge by the interrupt and scheduling latency
+	 */
+	std::chrono::steady_clock::time_point timestamp;
+	/** the number of notifications this event stands for, see GpioStormGuard */
+	unsigned count;
+};
+
+/**
+ * @brief A sysfs GPIO
+ *
+ * Every operation that can fail comes in two forms. The plain form throws
+ * std::system_error. The form taking a std::error_code & is noexcept, clears
+ * the code on success and sets it on failure, in the manner of
+ * std::filesystem; use it where failures such as a wait() timing out are
+ * routine.
+ *
+ * When a GPIO is found already exported, its direction, value and edge are
+ * read first and only written if they differ, so a process that restarts
+ * with LEAVE_EXPORTED or UNEXPORT_IF_EXPORTED_HERE finds its pins ready and
+ * configures them without touching sysfs attributes.
+ */
 class Gpio {
 
 public:
+	/**
+	 * @brief What to do with the GPIO when the object is destroyed
+	 */
+	enum Ownership {
+		/** unexport it if it is exported */
+		UNEXPORT_ON_DESTROY,
+		/** leave it exported and configured, for the next user */
+		LEAVE_EXPORTED,
+		/** unexport it only if this object exported it */
+		UNEXPORT_IF_EXPORTED_HERE,
+	};
+
 	/**
 	 * @brief Initialize a GPIO for output and set its value.
 	 *
-	 * @param num    the GPIO number
-	 * @param value  the value to be set
+	 * @param num        the GPIO number
+	 * @param value      the value to be set
+	 * @param ownership  what to do with the GPIO on destruction
 	 */
-	Gpio( unsigned num, gpio_value_t value );
+	Gpio( unsigned num, gpio_value_t value, Ownership ownership = UNEXPORT_ON_DESTROY );
 	/**
 	 * @brief Initialize an GPIO for input with a specific kind of interrupt
 	 *
-	 * @param num    the GPIO number
-	 * @param value  the interrupt type
+	 * @param num        the GPIO number
+	 * @param value      the interrupt type
+	 * @param ownership  what to do with the GPIO on destruction
 	 */
-	Gpio( unsigned num, gpio_edge_t edge );
+	Gpio( unsigned num, gpio_edge_t edge, Ownership ownership = UNEXPORT_ON_DESTROY );
 	/**
 	 * @brief Initialize a GPIO for input
 	 *
-	 * @param num    the GPIO number
+	 * @param num        the GPIO number
+	 * @param ownership  what to do with the GPIO on destruction
+	 */
+	Gpio( unsigned num, Ownership ownership = UNEXPORT_ON_DESTROY );
+	/**
+	 * @brief Initialize a GPIO for output and set its value without throwing
+	 *
+	 * @param num        the GPIO number
+	 * @param value      the value to be set
+	 * @param ec         set on failure
+	 * @param ownership  what to do with the GPIO on destruction
 	 */
-	Gpio( unsigned num );
+	Gpio( unsigned num, gpio_value_t value, std::error_code &ec, Ownership ownership = UNEXPORT_ON_DESTROY ) noexcept;
+	/**
+	 * @brief Initialize a GPIO for input with a specific kind of interrupt without throwing
+	 *
+	 * @param num        the GPIO number
+	 * @param edge       the interrupt type
+	 * @param ec         set on failure
+	 * @param ownership  what to do with the GPIO on destruction
+	 */
+	Gpio( unsigned num, gpio_edge_t edge, std::error_code &ec, Ownership ownership = UNEXPORT_ON_DESTROY ) noexcept;
+	/**
+	 * @brief Initialize a GPIO for input without throwing
+	 *
+	 * @param num        the GPIO number
+	 * @param ec         set on failure
+	 * @param ownership  what to do with the GPIO on destruction
+	 */
+	Gpio( unsigned num, std::error_code &ec, Ownership ownership = UNEXPORT_ON_DESTROY ) noexcept;
 	/**
 	 * @brief Allocate a GPIO object
 	 */
 	Gpio();
 	virtual ~Gpio();
 
+	/**
+	 * @brief Export several GPIOs at once and wait until they are usable
+	 *
+	 * Constructing a Gpio for each of @p nums afterwards skips the export.
+	 *
+	 * @param nums        the GPIO numbers
+	 * @param timeout_ms  overall deadline in milliseconds, or -1 to wait forever
+	 * @return the outcome for each of @p nums, in order
+	 */
+	static std::vector<std::error_code> export_all( const std::vector<uint16_t> &nums, int timeout_ms = GPIO_EXPORT_TIMEOUT_MS_DEFAULT );
+
 	/**
 	 * @brief The GPIO number
 	 * @return the GPIO number
 	 */
 	uint16_t num();
 
+	/**
+	 * @brief What happens to the GPIO on destruction
+	 */
+	Ownership ownership();
+	/**
+	 * @brief Change what happens to the GPIO on destruction
+	 */
+	void ownership( Ownership ownership );
+	/**
+	 * @brief Whether this object exported the GPIO, rather than finding it exported
+	 */
+	bool exported_here();
+
 	/**
 	 * @brief Get the value of the GPIO
 	 * @return the value of the GPIO
 	 */
 	gpio_value_t value();
+	gpio_value_t value( std::error_code &ec ) noexcept;
 	/**
 	 * @brief Set the value of the GPIO
 	 * @param value the value to use
 	 */
 	void value( gpio_value_t value );
+	void value( gpio_value_t value, std::error_code &ec ) noexcept;
 
 	/**
 	 * @brief Get the direction of the GPIO
 	 * @return the direction of the GPIO
 	 */
 	gpio_direction_t direction();
+	gpio_direction_t direction( std::error_code &ec ) noexcept;
 	/**
 	 * @brief Set the direction of the GPIO
 	 * @param direction the direction to use
 	 */
 	void direction( gpio_direction_t direction );
+	void direction( gpio_direction_t direction, std::error_code &ec ) noexcept;
 
 	/**
 	 * @brief Get the edge of the GPIO
 	 * @return the edge of the GPIO
 	 */
 	gpio_edge_t edge();
+	gpio_edge_t edge( std::error_code &ec ) noexcept;
 	/**
 	 * @brief Set the edge of the GPIO
 	 * @param edge the edge to use
 	 */
 	void edge( gpio_edge_t edge );
+	void edge( gpio_edge_t edge, std::error_code &ec ) noexcept;
 
 	/**
 	 * @brief Wait for an interrupt indefinitely
 	 */
 	void wait();
+	void wait( std::error_code &ec ) noexcept;
 
 	/**
 	 * @brief Wait for an interrupt
 	 *
+	 * A timeout is reported as std::errc::timed_out and interrupt() as
+	 * std::errc::interrupted.
+	 *
 	 * @param ms max milliseconds to wait
 	 */
 	void wait( uint16_t ms );
+	void wait( uint16_t ms, std::error_code &ec ) noexcept;
+
+	/**
+	 * @brief Wait for an interrupt for at most @p timeout
+	 *
+	 * Equivalent to wait_until( std::chrono::steady_clock::now() + timeout ).
+	 *
+	 * @param timeout max time to wait, with nanosecond resolution
+	 */
+	void wait_for( std::chrono::nanoseconds timeout );
+	void wait_for( std::chrono::nanoseconds timeout, std::error_code &ec ) noexcept;
+
+	/**
+	 * @brief Wait for an interrupt until an absolute deadline
+	 *
+	 * std::chrono::steady_clock is CLOCK_MONOTONIC. The deadline is kept
+	 * across signals and spurious wakeups, so a loop that advances its
+	 * deadline by a fixed period does not drift.
+	 *
+	 * @param deadline when to give up with std::errc::timed_out
+	 */
+	void wait_until( std::chrono::steady_clock::time_point deadline );
+	void wait_until( std::chrono::steady_clock::time_point deadline, std::error_code &ec ) noexcept;
+
+	/**
+	 * @brief Wait for an interrupt indefinitely and report the level that caused it
+	 *
+	 * The level is read from the descriptor that was polled, right after it
+	 * woke up. No further value() call is needed, and the level cannot have
+	 * been overtaken by a later change. The timestamp is taken in userspace as
+	 * soon as the wait returns, so it is an upper bound for the time of the
+	 * edge rather than the time of the edge itself.
+	 *
+	 * @param event  set to the edge, level and time of the interrupt
+	 */
+	void wait( GpioEvent &event );
+	void wait( GpioEvent &event, std::error_code &ec ) noexcept;
+	/**
+	 * @brief Wait for an interrupt for at most @p timeout and report the level that caused it
+	 *
+	 * @param timeout  max time to wait
+	 * @param event    set to the edge, level and time of the interrupt; untouched on failure
+	 */
+	void wait_for( std::chrono::nanoseconds timeout, GpioEvent &event );
+	void wait_for( std::chrono::nanoseconds timeout, GpioEvent &event, std::error_code &ec ) noexcept;
+	/**
+	 * @brief Wait for an interrupt until an absolute deadline and report the level that caused it
+	 *
+	 * @param deadline  when to give up with std::errc::timed_out
+	 * @param event     set to the edge, level and time of the interrupt; untouched on failure
+	 */
+	void wait_until( std::chrono::steady_clock::time_point deadline, GpioEvent &event );
+	void wait_until( std::chrono::steady_clock::time_point deadline, GpioEvent &event, std::error_code &ec ) noexcept;
 
 	/**
 	 * @brief Stop waiting for an interrupt
@@ -120,6 +285,8 @@ protected:
 
 	uint16_t gpio_num;
 	gpio_edge_t gpio_edge;
+	Ownership gpio_ownership;
+	bool gpio_exported_here;
 
 	int sys_class_gpio_gpio_n_value_fd;
 	int interruptee_fd;
@@ -127,9 +294,23 @@ protected:
 
 	void close_fds();
 
+	void wait_( const std::chrono::steady_clock::time_point *deadline, GpioEvent *event, std::error_code &ec ) noexcept;
+	/**
+	 * @brief Fill in @p event from the value descriptor after a wakeup
+	 *
+	 * @param timestamp  when the waiting thread woke up
+	 */
+	void read_event( std::chrono::steady_clock::time_point timestamp, GpioEvent &event, std::error_code &ec ) noexcept;
+
+	bool claim( std::error_code &ec ) noexcept;
+	void init_out( gpio_value_t value, std::error_code &ec ) noexcept;
+	void init_in( std::error_code &ec ) noexcept;
+
 	bool is_exported();
 	void export_();
+	void export_( std::error_code &ec ) noexcept;
 	void unexport();
+	void unexport( std::error_code &ec ) noexcept;
 };
 
 }
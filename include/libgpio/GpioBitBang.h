@@ -0,0 +1,220 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef com_github_cfriedt_GpioBitBang_h_
+#define com_github_cfriedt_GpioBitBang_h_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "libgpio/Gpio.h"
+
+namespace com {
+namespace github {
+namespace cfriedt {
+
+/**
+ * @brief Common engine for bit-banged serial protocols
+ *
+ * A transfer is first compiled into the complete sequence of line
+ * transitions and samples it needs, then executed in one tight loop of
+ * pwrite(2) / pread(2) calls on descriptors that stay open for the lifetime
+ * of the object. Writes that would not change a line are dropped while
+ * compiling.
+ */
+class GpioBitBang {
+
+public:
+	virtual ~GpioBitBang();
+
+	/**
+	 * @brief Payload throughput of the most recent transfer, in bits/s
+	 */
+	double bits_per_second();
+
+	/**
+	 * @brief Line transitions and samples issued by the most recent transfer
+	 */
+	size_t steps();
+
+protected:
+
+	struct Line {
+		std::unique_ptr<Gpio> gpio;
+		int value_fd;
+		int direction_fd;
+		bool open_drain;
+		int level;
+	};
+
+	struct Step {
+		int fd;
+		gpio_prop_t prop;
+		unsigned val;
+		/** for samples, the index of the bit to set in rx */
+		ssize_t bit;
+	};
+
+	std::vector<Line> lines;
+	std::vector<Step> program;
+
+	size_t last_bits;
+	size_t last_steps;
+	std::chrono::nanoseconds last_elapsed;
+
+	GpioBitBang();
+
+	/**
+	 * @brief Claim a line
+	 *
+	 * Push-pull outputs start at @p level. Open-drain lines are driven low by
+	 * switching them to output and released by switching them to input, so
+	 * the line rests high through its pull-up.
+	 *
+	 * @return the index of the line
+	 */
+	size_t output( uint16_t num, gpio_value_t level, bool open_drain = false );
+	size_t input( uint16_t num );
+
+	/**
+	 * @brief Compile a change of level, if it is a change
+	 */
+	void set( size_t line, int level );
+	/**
+	 * @brief Compile a sample of a line into bit @p bit of rx
+	 */
+	void sample( size_t line, size_t bit );
+
+	/**
+	 * @brief Run and then discard the compiled program
+	 *
+	 * @param rx       receives sampled bits, MSB first, must be zeroed
+	 * @param payload  bits transferred, for bits_per_second()
+	 */
+	void execute( uint8_t *rx, size_t payload );
+};
+
+/**
+ * @brief Bit-banged SPI master
+ */
+class GpioSpi : public GpioBitBang {
+
+public:
+	enum {
+		/** pass for miso or cs when the line is not used */
+		NONE = -1,
+	};
+
+	/**
+	 * @param sclk  clock GPIO
+	 * @param mosi  data out GPIO
+	 * @param miso  data in GPIO, or NONE
+	 * @param cs    active-low chip select GPIO, or NONE
+	 * @param mode  SPI mode 0 - 3 (CPOL << 1 | CPHA)
+	 */
+	GpioSpi( uint16_t sclk, uint16_t mosi, int miso = NONE, int cs = NONE, unsigned mode = 0 );
+	virtual ~GpioSpi();
+
+	/**
+	 * @brief Full-duplex transfer, MSB first
+	 *
+	 * @param tx   bytes to send
+	 * @param rx   storage for received bytes (may be NULL)
+	 * @param len  number of bytes
+	 */
+	void transfer( const uint8_t *tx, uint8_t *rx, size_t len );
+
+protected:
+	unsigned mode;
+	size_t sclk;
+	size_t mosi;
+	ssize_t miso;
+	ssize_t cs;
+};
+
+/**
+ * @brief Bit-banged I2C master on open-drain lines
+ *
+ * Clock stretching is not supported. A missing acknowledge throws ENXIO.
+ */
+class GpioI2c : public GpioBitBang {
+
+public:
+	GpioI2c( uint16_t scl, uint16_t sda );
+	virtual ~GpioI2c();
+
+	/**
+	 * @brief Write to a 7-bit address
+	 */
+	void write( uint8_t addr, const uint8_t *data, size_t len );
+	/**
+	 * @brief Read from a 7-bit address
+	 */
+	void read( uint8_t addr, uint8_t *data, size_t len );
+
+protected:
+	size_t scl;
+	size_t sda;
+
+	void start();
+	void stop();
+	void byte_out( uint8_t byte, size_t ack_bit );
+	void byte_in( size_t bit, bool ack );
+};
+
+/**
+ * @brief Serial-in, parallel-out shift register, e.g. a 74HC595
+ */
+class GpioShiftRegister : public GpioBitBang {
+
+public:
+	/**
+	 * @param data   serial data GPIO
+	 * @param clock  shift clock GPIO, rising edge
+	 * @param latch  storage / latch clock GPIO, rising edge
+	 */
+	GpioShiftRegister( uint16_t data, uint16_t clock, uint16_t latch );
+	virtual ~GpioShiftRegister();
+
+	/**
+	 * @brief Shift out bytes, MSB first, then latch them
+	 */
+	void shift( const uint8_t *data, size_t len );
+
+protected:
+	size_t data;
+	size_t clock;
+	size_t latch;
+};
+
+}
+}
+} // com.github.cfriedt
+
+#endif // com_github_cfriedt_GpioBitBang_h_
@@ -0,0 +1,261 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef com_github_cfriedt_GpioBroker_h_
+#define com_github_cfriedt_GpioBroker_h_
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "libgpio/libgpio.h"
+
+#define GPIO_BROKER_SHM_NAME_DEFAULT    "/libgpio-broker"
+#define GPIO_BROKER_SOCKET_PATH_DEFAULT "/run/libgpio-broker.sock"
+
+#define GPIO_BROKER_MAGIC   0x4750494f // "GPIO"
+#define GPIO_BROKER_VERSION 1
+
+namespace com {
+namespace github {
+namespace cfriedt {
+
+/**
+ * @brief The shared state of one brokered GPIO
+ *
+ * Every field except @p edges is published under the @p seq seqlock, which is
+ * odd while the broker is updating the slot. @p edges is incremented after
+ * every edge notification of an input, even one whose level reads back
+ * unchanged, and after each write that changed an output. It doubles as a
+ * futex word.
+ */
+struct GpioBrokerPin {
+	std::atomic<uint32_t> seq;
+	std::atomic<uint32_t> edges;
+	std::atomic<uint16_t> num;
+	std::atomic<uint8_t> direction;
+	std::atomic<uint8_t> value;
+	std::atomic<int32_t> owner;
+	std::atomic<uint64_t> timestamp_ns;
+};
+
+/**
+ * @brief Layout of the broker shared-memory segment
+ */
+struct GpioBrokerShm {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t npins;
+	int32_t pid;
+	GpioBrokerPin pin[ 1 ]; // actually npins
+};
+
+/**
+ * @brief A consistent snapshot of one brokered GPIO
+ */
+struct GpioBrokerState {
+	uint16_t num;
+	gpio_direction_t direction;
+	gpio_value_t value;
+	/** pid of the client that owns the output, 0 if unowned */
+	int32_t owner;
+	/** CLOCK_MONOTONIC time of the last edge */
+	uint64_t timestamp_ns;
+	/** edge sequence number */
+	uint32_t edges;
+};
+
+/**
+ * @brief Owns a set of GPIOs on behalf of several processes
+ *
+ * The broker exports and configures its GPIOs once, publishes their values in
+ * a shared-memory segment and arbitrates writes to outputs. Clients connect
+ * through a GpioBrokerClient.
+ */
+class GpioBroker {
+
+public:
+	/**
+	 * @brief Allocate a broker
+	 *
+	 * @param shm_name     name of the shared-memory segment, see shm_open(3)
+	 * @param socket_path  path of the control socket
+	 */
+	GpioBroker( const std::string &shm_name = GPIO_BROKER_SHM_NAME_DEFAULT, const std::string &socket_path = GPIO_BROKER_SOCKET_PATH_DEFAULT );
+	virtual ~GpioBroker();
+
+	/**
+	 * @brief Add a GPIO to be brokered, before start()
+	 *
+	 * Inputs are configured to interrupt on both edges.
+	 *
+	 * @param num        the GPIO number
+	 * @param direction  the direction of the GPIO
+	 */
+	void add( uint16_t num, gpio_direction_t direction );
+
+	/**
+	 * @brief Export and configure all GPIOs, publish their state and begin
+	 * listening for clients
+	 *
+	 * Throws EEXIST, before touching any GPIO, if another broker is serving
+	 * the shared-memory segment; a segment left behind by a broker that died
+	 * is reclaimed. On failure
+	 * everything set up so far is undone and start() may be retried.
+	 */
+	void start();
+
+	/**
+	 * @brief Serve clients and publish edges until interrupt() is called
+	 *
+	 * Calls start() if necessary.
+	 */
+	void run();
+
+	/**
+	 * @brief Stop run(); safe to call from another thread or a signal handler
+	 */
+	void interrupt();
+
+protected:
+
+	struct Pin {
+		uint16_t num;
+		gpio_direction_t direction;
+		bool exported_by_us;
+		int value_fd;
+		int owner_fd;
+	};
+
+	std::string shm_name;
+	std::string socket_path;
+
+	std::vector<Pin> pins;
+	std::map<uint16_t,size_t> index;
+	// client fd -> client pid
+	std::map<int,int32_t> clients;
+
+	GpioBrokerShm *shm;
+	size_t shm_size;
+
+	int listen_fd;
+	int interruptee_fd;
+	int interruptor_fd;
+
+	bool started;
+
+	void setup();
+	void publish( size_t idx, gpio_value_t value, int32_t owner, bool notified = false );
+	void handle( int fd );
+	void disconnect( int fd );
+	void stop();
+};
+
+/**
+ * @brief A process-side view of a GpioBroker
+ *
+ * Reading state never enters the kernel; waiting for an edge is a futex wait
+ * on the shared segment. Writes to outputs go through the broker.
+ */
+class GpioBrokerClient {
+
+public:
+	GpioBrokerClient( const std::string &shm_name = GPIO_BROKER_SHM_NAME_DEFAULT, const std::string &socket_path = GPIO_BROKER_SOCKET_PATH_DEFAULT );
+	virtual ~GpioBrokerClient();
+
+	/**
+	 * @brief The GPIO numbers served by the broker
+	 */
+	std::vector<uint16_t> nums();
+
+	/**
+	 * @brief Get a consistent snapshot of a GPIO
+	 * @param num the GPIO number
+	 */
+	GpioBrokerState state( uint16_t num );
+
+	/**
+	 * @brief Get the value of a GPIO
+	 * @param num the GPIO number
+	 */
+	gpio_value_t value( uint16_t num );
+
+	/**
+	 * @brief Get the edge sequence number of a GPIO
+	 * @param num the GPIO number
+	 */
+	uint32_t edges( uint16_t num );
+
+	/**
+	 * @brief Wait until the edge sequence number of a GPIO differs from @p seen
+	 *
+	 * @param num         the GPIO number
+	 * @param seen        the last edge sequence number observed
+	 * @param timeout_ms  max milliseconds to wait, or -1 to wait forever
+	 * @return the new edge sequence number
+	 */
+	uint32_t wait( uint16_t num, uint32_t seen, int timeout_ms = -1 );
+
+	/**
+	 * @brief Take exclusive ownership of an output
+	 *
+	 * Ownership lasts until release() or until this client disconnects.
+	 * Throws EBUSY if another client owns the output.
+	 *
+	 * @param num the GPIO number
+	 */
+	void claim( uint16_t num );
+
+	/**
+	 * @brief Give up ownership of an output
+	 * @param num the GPIO number
+	 */
+	void release( uint16_t num );
+
+	/**
+	 * @brief Set the value of an output, claiming it if it is unowned
+	 *
+	 * @param num    the GPIO number
+	 * @param value  the value to use
+	 */
+	void value( uint16_t num, gpio_value_t value );
+
+protected:
+
+	const GpioBrokerShm *shm;
+	size_t shm_size;
+	std::map<uint16_t,size_t> index;
+
+	int fd;
+
+	const GpioBrokerPin &pin( uint16_t num );
+	void request( unsigned op, uint16_t num, unsigned value );
+};
+
+}
+}
+} // com.github.cfriedt
+
+#endif // com_github_cfriedt_GpioBroker_h_
@@ -0,0 +1,244 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef com_github_cfriedt_GpioDispatcher_h_
+#define com_github_cfriedt_GpioDispatcher_h_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "libgpio/Gpio.h"
+#include "libgpio/GpioStormGuard.h"
+
+namespace com {
+namespace github {
+namespace cfriedt {
+
+/**
+ * @brief A bounded queue of GpioEvents, for subscribers that prefer to pull
+ */
+class GpioEventQueue {
+
+public:
+	/**
+	 * @param capacity  the number of events to hold before dropping the oldest
+	 */
+	GpioEventQueue( size_t capacity = 64 );
+	virtual ~GpioEventQueue();
+
+	/**
+	 * @brief Append an event, dropping the oldest one if the queue is full
+	 */
+	void push( const GpioEvent &event );
+
+	/**
+	 * @brief Remove the oldest event
+	 *
+	 * @param event       storage for the event
+	 * @param timeout_ms  max milliseconds to wait, or -1 to wait forever
+	 * @return false if no event arrived in time
+	 */
+	bool pop( GpioEvent &event, int timeout_ms = -1 );
+
+	/**
+	 * @brief The number of queued events
+	 */
+	size_t size();
+
+	/**
+	 * @brief The number of events dropped because the queue was full
+	 */
+	size_t dropped();
+
+protected:
+	size_t capacity;
+	size_t ndropped;
+	std::deque<GpioEvent> events;
+	std::mutex lock;
+	std::condition_variable cv;
+};
+
+/**
+ * @brief Fan edges on one GPIO out to any number of subscribers
+ *
+ * Each GPIO is opened once, configured for both edges, and watched by a
+ * single thread. Every kernel notification costs one read, after which the
+ * rising / falling filter of each subscriber is applied in software and its
+ * callback is invoked on the dispatcher thread.
+ *
+ * Callbacks must not block for long; they may subscribe and unsubscribe, and
+ * may even destroy the dispatcher, in which case its thread exits as soon as
+ * the callback returns.
+ *
+ * Optionally, each GPIO is protected by a GpioStormGuard. While a GPIO is in a
+ * storm, subscribers receive at most one GPIO_EDGE_BOTH event per coalescing
+ * interval, regardless of their filter. By default the GPIO is not watched
+ * during a storm, so it costs no wakeups: at the end of each interval its
+ * level is read once, the event's count is 1 meaning "at least one", and the
+ * GPIO is watched again once an interval passes without a notification. With
+ * GpioStormGuard::Config::exact, every notification is still read and
+ * counted, and the event's count is the number of notifications it stands
+ * for.
+ */
+class GpioDispatcher {
+
+public:
+	typedef std::function<void( const GpioEvent & )> Callback;
+	typedef unsigned Subscription;
+	typedef std::function<void( uint16_t num, bool storming, const GpioStormGuard::Counters &counters )> StormCallback;
+
+	GpioDispatcher();
+	virtual ~GpioDispatcher();
+
+	/**
+	 * @brief Subscribe to edges on a GPIO
+	 *
+	 * @param num       the GPIO number
+	 * @param edge      the edges of interest
+	 * @param callback  invoked for every matching edge
+	 * @return a handle for unsubscribe()
+	 */
+	Subscription subscribe( uint16_t num, gpio_edge_t edge, Callback callback );
+	/**
+	 * @brief Subscribe to edges on a GPIO, delivering them to a queue
+	 *
+	 * @param num    the GPIO number
+	 * @param edge   the edges of interest
+	 * @param queue  receives every matching edge; must outlive the subscription
+	 * @return a handle for unsubscribe()
+	 */
+	Subscription subscribe( uint16_t num, gpio_edge_t edge, GpioEventQueue &queue );
+
+	/**
+	 * @brief Cancel a subscription
+	 *
+	 * The GPIO is released once its last subscription is cancelled.
+	 *
+	 * Once this returns, the callback is not invoked again, and is not running
+	 * on any other thread, so whatever it refers to may be destroyed. Only when
+	 * called from the callback itself (or from another callback delivered on
+	 * the same thread) does this return while that delivery is still running.
+	 */
+	void unsubscribe( Subscription subscription );
+
+	/**
+	 * @brief Configure storm protection for all GPIOs
+	 *
+	 * Protection is disabled by default.
+	 */
+	void storm( const GpioStormGuard::Config &config );
+	/**
+	 * @brief Configure storm protection for one subscribed GPIO
+	 */
+	void storm( uint16_t num, const GpioStormGuard::Config &config );
+	/**
+	 * @brief Get the storm counters of a subscribed GPIO
+	 */
+	GpioStormGuard::Counters storm_counters( uint16_t num );
+	/**
+	 * @brief Be notified, on the dispatcher thread, when a GPIO enters or
+	 * leaves a storm
+	 */
+	void on_storm( StormCallback callback );
+
+protected:
+
+	struct Subscriber {
+		Subscription id;
+		gpio_edge_t edge;
+		std::shared_ptr<Callback> callback;
+	};
+
+	struct Source {
+		std::unique_ptr<Gpio> gpio;
+		int fd;
+		gpio_value_t value;
+		std::vector<Subscriber> subscribers;
+		GpioStormGuard guard;
+	};
+
+	std::map<uint16_t,Source> sources;
+	// GPIOs being set up by subscribe() without the lock, and by how many threads
+	std::map<uint16_t,unsigned> opening;
+	Subscription next_id;
+
+	GpioStormGuard::Config storm_config;
+	std::shared_ptr<StormCallback> storm_callback;
+
+	std::mutex lock;
+	std::thread thread;
+	bool stopping;
+
+	// live subscriptions, and those whose callback is running, on which thread
+	std::set<Subscription> live;
+	std::vector<std::pair<Subscription,std::thread::id>> inflight;
+	std::condition_variable delivered;
+
+	int interruptee_fd;
+	int interruptor_fd;
+
+	void run();
+	void wake();
+	/**
+	 * @brief Export a GPIO, configure both edges and open its value, unlocked
+	 */
+	void prepare( uint16_t num, Source &source );
+	/**
+	 * @brief Add a subscriber to a GPIO in sources, with the lock held
+	 */
+	Subscription add( uint16_t num, Subscriber subscriber );
+	bool flush( std::chrono::steady_clock::time_point now );
+
+	/**
+	 * @brief Invoke the callback of a subscriber, unless it was cancelled
+	 *
+	 * @return false if the callback destroyed the dispatcher
+	 */
+	bool invoke( const Subscriber &subscriber, const GpioEvent &event );
+
+	/**
+	 * @brief Record a level read from a GPIO and notify subscribers
+	 *
+	 * Called from the dispatcher thread for every kernel notification.
+	 *
+	 * @param num        the GPIO number
+	 * @param value      the level read
+	 * @param timestamp  when the level was read
+	 * @return false if a callback destroyed the dispatcher
+	 */
+	bool deliver( uint16_t num, gpio_value_t value, std::chrono::steady_clock::time_point timestamp );
+};
+
+}
+}
+} // com.github.cfriedt
+
+#endif // com_github_cfriedt_GpioDispatcher_h_
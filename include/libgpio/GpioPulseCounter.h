@@ -0,0 +1,152 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef com_github_cfriedt_GpioPulseCounter_h_
+#define com_github_cfriedt_GpioPulseCounter_h_
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+
+#include "libgpio/GpioDispatcher.h"
+
+namespace com {
+namespace github {
+namespace cfriedt {
+
+/**
+ * @brief Statistics of a pulse train, see GpioPulseCounter
+ */
+struct GpioPulseStats {
+	/** rising edges since the last reset */
+	uint64_t rising;
+	/** falling edges since the last reset */
+	uint64_t falling;
+	/** notifications that arrived coalesced and could not be timed */
+	uint64_t untimed;
+
+	/** complete cycles (rising edge to rising edge) within the window */
+	unsigned cycles;
+	/** mean frequency over those cycles, in Hz, 0 if there are none */
+	double frequency;
+	/** mean period over those cycles */
+	std::chrono::nanoseconds period;
+	/** mean fraction of each period spent high */
+	double duty_cycle;
+
+	/** width of the most recent high pulse */
+	std::chrono::nanoseconds high;
+	/** width of the most recent low pulse */
+	std::chrono::nanoseconds low;
+};
+
+/**
+ * @brief Count pulses on an input and measure their frequency and duty cycle
+ *
+ * Edges are timestamped and accumulated by the GpioDispatcher thread, so the
+ * caller is never woken per pulse. Statistics are kept incrementally over a
+ * rolling window and stats() only takes a lock to copy them.
+ */
+class GpioPulseCounter {
+
+public:
+	typedef std::chrono::steady_clock::time_point time_point;
+
+	/**
+	 * @brief Count pulses on a GPIO
+	 *
+	 * @param dispatcher  the dispatcher to subscribe with; must outlive the counter
+	 * @param num         the GPIO number
+	 * @param window      the period over which frequency, period and duty cycle are averaged
+	 */
+	GpioPulseCounter( GpioDispatcher &dispatcher, uint16_t num, std::chrono::nanoseconds window = std::chrono::seconds( 1 ) );
+	/**
+	 * @brief Allocate a counter that is fed through edge()
+	 *
+	 * @param window  the period over which frequency, period and duty cycle are averaged
+	 */
+	GpioPulseCounter( std::chrono::nanoseconds window = std::chrono::seconds( 1 ) );
+	/**
+	 * @brief Unsubscribe, waiting for an edge being recorded on the dispatcher
+	 * thread, so the counter may be destroyed while edges arrive
+	 */
+	virtual ~GpioPulseCounter();
+
+	/**
+	 * @brief Change the averaging window
+	 */
+	void window( std::chrono::nanoseconds window );
+
+	/**
+	 * @brief Record an edge
+	 */
+	void edge( const GpioEvent &event );
+
+	/**
+	 * @brief Get the statistics, averaged over the window ending at @p now
+	 */
+	GpioPulseStats stats( time_point now = std::chrono::steady_clock::now() );
+
+	/**
+	 * @brief Clear all counts and statistics
+	 */
+	void reset();
+
+protected:
+
+	struct Cycle {
+		time_point start;
+		std::chrono::nanoseconds high;
+		std::chrono::nanoseconds period;
+	};
+
+	GpioDispatcher *dispatcher;
+	GpioDispatcher::Subscription subscription;
+
+	std::mutex lock;
+	std::chrono::nanoseconds win;
+
+	uint64_t nrising;
+	uint64_t nfalling;
+	uint64_t nuntimed;
+
+	bool have_rise;
+	bool have_fall;
+	time_point last_rise;
+	time_point last_fall;
+	std::chrono::nanoseconds last_high;
+	std::chrono::nanoseconds last_low;
+
+	std::deque<Cycle> cycles;
+	std::chrono::nanoseconds sum_high;
+	std::chrono::nanoseconds sum_period;
+
+	void trim( time_point now );
+};
+
+}
+}
+} // com.github.cfriedt
+
+#endif // com_github_cfriedt_GpioPulseCounter_h_
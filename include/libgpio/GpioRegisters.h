@@ -0,0 +1,268 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef com_github_cfriedt_GpioRegisters_h_
+#define com_github_cfriedt_GpioRegisters_h_
+
+#include <sys/types.h>
+
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "libgpio/libgpio.h"
+
+namespace com {
+namespace github {
+namespace cfriedt {
+
+/**
+ * @brief Where a GPIO controller keeps its registers, see GpioRegisters
+ *
+ * Offsets are in bytes from the start of the mapping and registers are 32
+ * bits wide. Level, output, set and clear registers hold one bit per pin
+ * in banks of @ref bank_pins pins, @ref bank_stride bytes apart. Direction
+ * registers hold a field of @ref dir_bits bits per pin, @ref dir_pins pins per
+ * register, 4 bytes apart.
+ */
+struct GpioRegisterLayout {
+	/** marks a register the controller does not have */
+	static const uint32_t NONE;
+
+	/** the name of the controller */
+	const char *name;
+	/** the number of bytes to map */
+	size_t size;
+	/** the number of pins */
+	unsigned npins;
+
+	/** pins per bank */
+	unsigned bank_pins;
+	/** bytes between consecutive banks */
+	unsigned bank_stride;
+
+	/** the level register, read to sample inputs */
+	uint32_t level;
+	/** the output data register, or NONE; read-modify-written when there is no set / clear pair */
+	uint32_t out;
+	/** the register where writing 1 drives a pin high, or NONE */
+	uint32_t set;
+	/** the register where writing 1 drives a pin low, or NONE */
+	uint32_t clear;
+
+	/** the first direction register */
+	uint32_t direction;
+	/** bits per pin in a direction register */
+	unsigned dir_bits;
+	/** pins per direction register */
+	unsigned dir_pins;
+	/** the field value for an input */
+	uint32_t dir_in;
+	/** the field value for an output */
+	uint32_t dir_out;
+
+	/**
+	 * @brief The Broadcom BCM2835 family (Raspberry Pi), mapped through /dev/gpiomem
+	 */
+	static const GpioRegisterLayout &bcm2835();
+};
+
+/**
+ * @brief Access a GPIO controller through its memory-mapped registers
+ *
+ * Driving a pin is a single 32-bit store when the layout has set / clear
+ * registers, and those stores are atomic with respect to every other user of
+ * the controller. Without them, the output register is read-modify-written
+ * under a lock that only serializes users of this object.
+ *
+ * Pin numbers are controller-relative and are not checked by the accessors;
+ * see GpioRegisterPin for a checked handle.
+ */
+class GpioRegisters {
+
+public:
+	/**
+	 * @brief Map a GPIO controller
+	 *
+	 * @param layout  the register layout; must outlive the object
+	 * @param path    the device or file to map
+	 * @param offset  where the registers start in @p path
+	 */
+	GpioRegisters( const GpioRegisterLayout &layout, const std::string &path = "/dev/gpiomem", off_t offset = 0 );
+	virtual ~GpioRegisters();
+
+	/**
+	 * @brief The register layout
+	 */
+	const GpioRegisterLayout &layout();
+
+	/**
+	 * @brief Drive a pin high
+	 */
+	void set( unsigned pin ) {
+		set_mask( pin / regs_layout.bank_pins, (uint32_t) 1 << ( pin % regs_layout.bank_pins ) );
+	}
+	/**
+	 * @brief Drive a pin low
+	 */
+	void clear( unsigned pin ) {
+		clear_mask( pin / regs_layout.bank_pins, (uint32_t) 1 << ( pin % regs_layout.bank_pins ) );
+	}
+	/**
+	 * @brief Drive several pins of one bank high
+	 */
+	void set_mask( unsigned bank, uint32_t mask );
+	/**
+	 * @brief Drive several pins of one bank low
+	 */
+	void clear_mask( unsigned bank, uint32_t mask );
+	/**
+	 * @brief Drive some pins of one bank high and others low
+	 */
+	void write_mask( unsigned bank, uint32_t set, uint32_t clear );
+	/**
+	 * @brief Read the levels of all pins of one bank
+	 */
+	uint32_t levels( unsigned bank ) {
+		return reg( regs_layout.level + bank * regs_layout.bank_stride );
+	}
+
+	/**
+	 * @brief Get the level of a pin
+	 */
+	gpio_value_t value( unsigned pin ) {
+		return ( levels( pin / regs_layout.bank_pins ) >> ( pin % regs_layout.bank_pins ) ) & 1 ? GPIO_VALUE_HIGH : GPIO_VALUE_LOW;
+	}
+	/**
+	 * @brief Drive a pin
+	 */
+	void value( unsigned pin, gpio_value_t value ) {
+		if ( GPIO_VALUE_HIGH == value ) {
+			set( pin );
+		} else {
+			clear( pin );
+		}
+	}
+
+	/**
+	 * @brief Get the direction of a pin
+	 *
+	 * Any field value other than dir_out, such as an alternate function, reads as an input.
+	 */
+	gpio_direction_t direction( unsigned pin );
+	/**
+	 * @brief Set the direction of a pin
+	 */
+	void direction( unsigned pin, gpio_direction_t direction );
+
+protected:
+	const GpioRegisterLayout &regs_layout;
+	volatile uint8_t *base;
+	std::mutex lock;
+
+	volatile uint32_t &reg( uint32_t offset ) {
+		return *(volatile uint32_t *)( base + offset );
+	}
+};
+
+/**
+ * @brief One pin of a GpioRegisters
+ */
+class GpioRegisterPin {
+
+public:
+	/**
+	 * @param regs       the controller; must outlive the pin
+	 * @param pin        the controller-relative pin number
+	 * @param direction  the direction to configure
+	 */
+	GpioRegisterPin( GpioRegisters &regs, unsigned pin, gpio_direction_t direction );
+	virtual ~GpioRegisterPin();
+
+	unsigned num();
+
+	gpio_value_t value() {
+		return regs.value( pin );
+	}
+	void value( gpio_value_t value ) {
+		regs.value( pin, value );
+	}
+	void set() {
+		regs.set( pin );
+	}
+	void clear() {
+		regs.clear( pin );
+	}
+
+	gpio_direction_t direction();
+	void direction( gpio_direction_t direction );
+
+protected:
+	GpioRegisters &regs;
+	unsigned pin;
+};
+
+/**
+ * @brief A group of pins of a GpioRegisters driven and sampled as one word
+ *
+ * Bit i of a value corresponds to the i-th pin given on construction. A
+ * write costs at most one set and one clear store per bank involved.
+ */
+class GpioRegisterPort {
+
+public:
+	/**
+	 * @param regs       the controller; must outlive the port
+	 * @param pins       controller-relative pin numbers, at most 32
+	 * @param direction  the direction to configure for every pin
+	 */
+	GpioRegisterPort( GpioRegisters &regs, const std::vector<unsigned> &pins, gpio_direction_t direction );
+	virtual ~GpioRegisterPort();
+
+	/**
+	 * @brief Drive every pin from the bits of @p value
+	 */
+	void write( uint32_t value );
+	/**
+	 * @brief Sample every pin into the bits of the result
+	 */
+	uint32_t read();
+
+protected:
+	struct Bank {
+		unsigned bank;
+		// (bit in the port value, bit in the bank) for each pin of the port in this bank
+		std::vector<std::pair<unsigned,unsigned>> bits;
+	};
+
+	GpioRegisters &regs;
+	std::vector<Bank> banks;
+};
+
+}
+}
+} // com.github.cfriedt
+
+#endif // com_github_cfriedt_GpioRegisters_h_
@@ -0,0 +1,233 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef com_github_cfriedt_GpioSampler_h_
+#define com_github_cfriedt_GpioSampler_h_
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "libgpio/Gpio.h"
+
+namespace com {
+namespace github {
+namespace cfriedt {
+
+/**
+ * @brief A run of consecutive samples of a set of GPIOs, see GpioSampler
+ *
+ * Samples are stored by column: each GPIO has its own bit column with one bit
+ * per sample, sample i in bit i % 64 of word i / 64.
+ */
+struct GpioSampleChunk {
+	/** the tick of the first sample; ticks count sampler periods since start() */
+	uint64_t tick;
+	/** the number of samples held */
+	size_t count;
+	/** the number of words in each column */
+	size_t stride;
+	/** the columns, one after the other */
+	std::vector<uint64_t> bits;
+
+	/**
+	 * @brief The bit column of the GPIO at @p index in GpioSampler::nums()
+	 */
+	const uint64_t *column( size_t index ) const {
+		return bits.data() + index * stride;
+	}
+	/**
+	 * @brief The level of the GPIO at @p index in GpioSampler::nums() in sample @p i
+	 */
+	gpio_value_t level( size_t index, size_t i ) const {
+		return ( column( index )[ i / 64 ] >> ( i % 64 ) ) & 1 ? GPIO_VALUE_HIGH : GPIO_VALUE_LOW;
+	}
+};
+
+/**
+ * @brief Take fixed-rate snapshots of a set of inputs, like a logic analyzer
+ *
+ * A timerfd paces a sampling thread, which reads every GPIO per tick through
+ * descriptors that stay open for the lifetime of the sampler. Samples are
+ * bit-packed into chunks from a pool allocated up front. Full chunks are
+ * queued for the consumer, which reads them in place and hands them back with
+ * release().
+ *
+ * Each chunk covers consecutive ticks. When the timer has expired more than
+ * once between reads, the missed ticks are counted and the current chunk is
+ * ended, so that the next one starts at the right tick. When no chunk is free
+ * because the consumer has fallen behind, the tick is counted as an overrun
+ * and not sampled.
+ */
+class GpioSampler {
+
+public:
+	struct Counters {
+		/** timer expirations since start() */
+		uint64_t ticks;
+		/** ticks that were sampled */
+		uint64_t samples;
+		/** ticks that passed without being sampled, because the thread was late */
+		uint64_t missed;
+		/** ticks that were not sampled because no chunk was free */
+		uint64_t overruns;
+		/** reads that failed; the level is recorded as low */
+		uint64_t errors;
+	};
+
+	/**
+	 * @brief Prepare to sample a set of GPIOs
+	 *
+	 * Each GPIO is configured as an input.
+	 *
+	 * @param nums     the GPIO numbers
+	 * @param period   the sampling period, e.g. 100 us for 10 kHz
+	 * @param samples  the number of samples per chunk
+	 * @param chunks   the number of chunks in the pool
+	 */
+	GpioSampler( const std::vector<uint16_t> &nums, std::chrono::nanoseconds period, size_t samples = 4096, size_t chunks = 8 );
+	virtual ~GpioSampler();
+
+	/**
+	 * @brief The GPIO numbers, in column order
+	 */
+	const std::vector<uint16_t> &nums();
+	/**
+	 * @brief The sampling period
+	 */
+	std::chrono::nanoseconds period();
+
+	/**
+	 * @brief Start sampling
+	 *
+	 * Ticks and counters restart from 0.
+	 */
+	void start();
+	/**
+	 * @brief Stop sampling, queueing the partially filled chunk if any
+	 */
+	void stop();
+
+	/**
+	 * @brief Take the oldest full chunk
+	 *
+	 * The chunk belongs to the caller until it is passed to release().
+	 *
+	 * @param chunk       set to the chunk
+	 * @param timeout_ms  max milliseconds to wait, or -1 to wait forever
+	 * @return false if no chunk arrived in time
+	 */
+	bool pop( const GpioSampleChunk *&chunk, int timeout_ms = -1 );
+	/**
+	 * @brief Return a chunk obtained from pop() to the pool
+	 */
+	void release( const GpioSampleChunk *chunk );
+
+	/**
+	 * @brief Get the counters
+	 */
+	Counters counters();
+
+protected:
+	std::vector<uint16_t> gpio_nums;
+	std::vector<std::unique_ptr<Gpio>> gpios;
+	std::vector<int> fds;
+	std::chrono::nanoseconds sample_period;
+	size_t chunk_samples;
+
+	std::vector<GpioSampleChunk> pool;
+	std::vector<GpioSampleChunk *> free_chunks;
+	std::deque<GpioSampleChunk *> full_chunks;
+	// only touched by the sampling thread, or with it stopped
+	GpioSampleChunk *current;
+
+	Counters stats;
+
+	std::mutex lock;
+	std::condition_variable cv;
+	std::thread thread;
+
+	int timer_fd;
+	int interruptee_fd;
+	int interruptor_fd;
+
+	void run();
+	void close_fds();
+
+	/**
+	 * @brief Sample every GPIO once
+	 *
+	 * Called from the sampling thread after each read of the timer.
+	 *
+	 * @param expirations  the number of timer expirations since the last call
+	 */
+	void tick( uint64_t expirations );
+	/**
+	 * @brief Queue the current chunk, if it holds any samples
+	 */
+	void hand_off();
+};
+
+/**
+ * @brief Write GpioSampleChunks as a Value Change Dump (IEEE 1364)
+ *
+ * The header is written on construction. Only changes are written, so levels
+ * are held across ticks that were missed.
+ */
+class GpioVcdWriter {
+
+public:
+	/**
+	 * @param os      the stream to write to
+	 * @param nums    the GPIO numbers, in column order
+	 * @param period  the sampling period
+	 */
+	GpioVcdWriter( std::ostream &os, const std::vector<uint16_t> &nums, std::chrono::nanoseconds period );
+	virtual ~GpioVcdWriter();
+
+	/**
+	 * @brief Write the changes in a chunk
+	 *
+	 * Chunks must be written in order of their tick.
+	 */
+	void write( const GpioSampleChunk &chunk );
+
+protected:
+	std::ostream &os;
+	std::vector<std::string> ids;
+	std::chrono::nanoseconds period;
+	std::vector<int> last;
+};
+
+}
+}
+} // com.github.cfriedt
+
+#endif // com_github_cfriedt_GpioSampler_h_
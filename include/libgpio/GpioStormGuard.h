@@ -0,0 +1,134 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef com_github_cfriedt_GpioStormGuard_h_
+#define com_github_cfriedt_GpioStormGuard_h_
+
+#include <stdint.h>
+
+#include <chrono>
+
+namespace com {
+namespace github {
+namespace cfriedt {
+
+/**
+ * @brief Detect and contain interrupt storms on one GPIO
+ *
+ * While the rate of edge notifications stays below a threshold, every one of
+ * them is delivered. Once it is exceeded, the GPIO is in a storm: the caller
+ * holds notifications back until holdoff(), then calls flush() to learn how
+ * many were coalesced into one aggregated event. A storm ends after an
+ * interval in which no notification arrived.
+ *
+ * Unless Config::exact is set, the caller is expected to stop watching the
+ * GPIO while it storms and to record at most one notification per interval,
+ * so the counts of a storm are lower bounds.
+ */
+class GpioStormGuard {
+
+public:
+	typedef std::chrono::steady_clock::time_point time_point;
+
+	struct Config {
+		/** notifications per second that start a storm, 0 to disable */
+		unsigned threshold;
+		/** period over which the rate is measured */
+		std::chrono::milliseconds window;
+		/** period over which notifications are coalesced during a storm */
+		std::chrono::milliseconds interval;
+		/**
+		 * keep watching the GPIO during a storm so every notification is
+		 * counted, at the cost of one wakeup and read per notification
+		 */
+		bool exact;
+
+		Config( unsigned threshold = 0, std::chrono::milliseconds window = std::chrono::milliseconds( 100 ), std::chrono::milliseconds interval = std::chrono::milliseconds( 100 ), bool exact = false )
+		: threshold( threshold ), window( window ), interval( interval ), exact( exact ) {}
+	};
+
+	struct Counters {
+		/** notifications recorded */
+		uint64_t edges;
+		/** notifications folded into aggregated events */
+		uint64_t coalesced;
+		/** storms entered */
+		uint64_t storms;
+	};
+
+	GpioStormGuard( const Config &config = Config() );
+	virtual ~GpioStormGuard();
+
+	void config( const Config &config );
+	const Config &config();
+
+	/**
+	 * @brief Record an edge notification
+	 *
+	 * @param t  when it was observed
+	 * @return true if it should be delivered as usual, false if it was
+	 *         coalesced into the event that follows holdoff()
+	 */
+	bool edge( time_point t );
+
+	/**
+	 * @brief End the current coalescing interval
+	 *
+	 * Call no earlier than holdoff() while storming. Ends the storm if the
+	 * interval was quiet.
+	 *
+	 * @param t  the current time
+	 * @return the number of notifications coalesced during the interval
+	 */
+	unsigned flush( time_point t );
+
+	/**
+	 * @brief Whether the GPIO is in a storm
+	 */
+	bool storming();
+
+	/**
+	 * @brief While storming, when the current coalescing interval ends
+	 */
+	time_point holdoff();
+
+	const Counters &counters();
+
+protected:
+	Config cfg;
+	Counters cnt;
+
+	bool in_storm;
+	unsigned pending;
+
+	time_point window_start;
+	unsigned window_count;
+	time_point interval_end;
+};
+
+}
+}
+} // com.github.cfriedt
+
+#endif // com_github_cfriedt_GpioStormGuard_h_
@@ -0,0 +1,113 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LIBGPIO_GPIOCHIP_H_
+#define LIBGPIO_GPIOCHIP_H_
+
+#include <sys/cdefs.h>
+
+#include <stdint.h>
+
+__BEGIN_DECLS
+
+#define GPIO_CHIP_NAME_MAX  32
+#define GPIO_CHIP_LABEL_MAX 64
+
+typedef struct {
+	char name[ GPIO_CHIP_NAME_MAX ];
+	char label[ GPIO_CHIP_LABEL_MAX ];
+	uint16_t base;
+	uint16_t ngpio;
+} gpio_chip_t;
+
+/**
+ * @brief (Re)build the gpiochip index
+ *
+ * Scans <sysfs root>/gpiochip* once and replaces the in-memory index used by
+ * the lookup functions below. The index is built lazily on first lookup, so
+ * calling this is only necessary when controllers come or go at runtime. If
+ * the index is invalidated during the scan, e.g. by gpio_sysfs_root_set(),
+ * the new root is scanned instead.
+ *
+ * @return the number of chips indexed, otherwise -1 and errno is set
+ */
+int gpio_chip_refresh( void );
+/**
+ * @brief Discard the gpiochip index
+ *
+ * The next lookup rescans the sysfs root. gpio_sysfs_root_set() does this
+ * implicitly.
+ */
+void gpio_chip_invalidate( void );
+
+/**
+ * @brief The number of indexed chips
+ * @return the number of chips, otherwise -1 and errno is set
+ */
+int gpio_chip_count( void );
+
+/**
+ * @brief Get an indexed chip, in order of ascending base
+ *
+ * @param idx   index in the range [0, gpio_chip_count())
+ * @param chip  storage for the chip description
+ * @return 0 on success, otherwise -1 and errno is set
+ */
+int gpio_chip_get( unsigned idx, gpio_chip_t *chip );
+
+/**
+ * @brief Find a chip by its label
+ *
+ * If several chips share a label, the one with the lowest base is returned.
+ *
+ * @param label  the chip label
+ * @param chip   storage for the chip description
+ * @return 0 on success, otherwise -1 and errno is set (ENOENT if not found)
+ */
+int gpio_chip_find( const char *label, gpio_chip_t *chip );
+
+/**
+ * @brief Find the chip that provides a global GPIO number
+ *
+ * @param gpio    the global GPIO number
+ * @param chip    storage for the chip description (may be NULL)
+ * @param offset  storage for the offset of @p gpio within the chip (may be NULL)
+ * @return 0 on success, otherwise -1 and errno is set (ENOENT if not found)
+ */
+int gpio_chip_find_gpio( uint16_t gpio, gpio_chip_t *chip, uint16_t *offset );
+
+/**
+ * @brief Resolve a chip label and offset to a global GPIO number
+ *
+ * @param label   the chip label
+ * @param offset  the offset within the chip
+ * @param gpio    storage for the global GPIO number
+ * @return 0 on success, otherwise -1 and errno is set (ENOENT if the label is
+ *         unknown, ERANGE if @p offset is beyond the chip)
+ */
+int gpio_chip_gpio( const char *label, uint16_t offset, uint16_t *gpio );
+
+__END_DECLS
+
+#endif // LIBGPIO_GPIOCHIP_H_
@@ -0,0 +1,149 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LIBGPIO_GPIOTRACE_H_
+#define LIBGPIO_GPIOTRACE_H_
+
+#include <sys/cdefs.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+
+__BEGIN_DECLS
+
+typedef enum {
+	GPIO_TRACE_OP_PROP_GET,
+	GPIO_TRACE_OP_PROP_SET,
+	GPIO_TRACE_OP_PROP_READ,
+	GPIO_TRACE_OP_PROP_WRITE,
+	GPIO_TRACE_OP_IS_EXPORTED,
+	GPIO_TRACE_OP_EXPORT,
+	GPIO_TRACE_OP_UNEXPORT,
+	GPIO_TRACE_OP_EXPORT_BULK,
+	GPIO_TRACE_OP_WAIT,
+	GPIO_TRACE_OP_INTERRUPT,
+	GPIO_TRACE_OP_MAX,
+} gpio_trace_op_t;
+
+#define GPIO_TRACE_MAGIC   "GPIOTRC"
+// 2: the timeout of a wait is in microseconds rather than milliseconds
+#define GPIO_TRACE_VERSION 2
+
+#define GPIO_TRACE_GPIO_NONE 0xffff
+
+/**
+ * @brief Header of a binary trace file, followed by gpio_trace_event_t records
+ */
+typedef struct {
+	char magic[ 8 ];
+	uint32_t version;
+	uint32_t event_size;
+	int32_t pid;
+	uint32_t reserved;
+} gpio_trace_header_t;
+
+/**
+ * @brief One traced operation
+ *
+ * For property operations, arg[ 0 ] is the gpio_prop_t and arg[ 1 ] the value
+ * written or read. For fd-based property operations, gpio is
+ * GPIO_TRACE_GPIO_NONE and arg[ 1 ] holds the value while the fd is not
+ * recorded. For bulk exports, arg[ 0 ] is the number of GPIOs and arg[ 1 ] the
+ * timeout in milliseconds. For waits, arg[ 0 ] is the timeout in microseconds
+ * (milliseconds in version 1 files), or -1 to wait forever.
+ */
+typedef struct {
+	uint64_t start_ns;
+	uint64_t end_ns;
+	uint32_t tid;
+	uint16_t op;
+	uint16_t gpio;
+	int32_t arg[ 2 ];
+	int32_t err;
+	uint32_t reserved;
+} gpio_trace_event_t;
+
+extern int gpio_trace_enabled;
+
+/**
+ * @brief Whether tracing is on; a single, predictable branch when it is not
+ */
+#define GPIO_TRACE_ENABLED() __builtin_expect( __atomic_load_n( & gpio_trace_enabled, __ATOMIC_RELAXED ), 0 )
+
+/**
+ * @brief Declare @p t and, if tracing is on, set it to the start time
+ */
+#define GPIO_TRACE_BEGIN( t ) \
+	uint64_t t = GPIO_TRACE_ENABLED() ? gpio_trace_now() : 0
+
+/**
+ * @brief Record an operation started by GPIO_TRACE_BEGIN( t )
+ *
+ * @p r is the return value of the operation; -1 means errno holds the error.
+ */
+#define GPIO_TRACE_END( t, op, gpio, arg0, arg1, r ) \
+	do { \
+		if ( __builtin_expect( 0 != (t), 0 ) ) { \
+			gpio_trace_record( (op), (gpio), (arg0), (arg1), (t), -1 == (r) ); \
+		} \
+	} while( 0 )
+
+/**
+ * @brief Start tracing to a file
+ *
+ * Events are buffered per thread without locks and appended to @p path in
+ * whole buffers.
+ *
+ * @param path  the trace file, truncated if it exists
+ * @return 0 on success, otherwise -1 and errno is set
+ */
+int gpio_trace_start( const char *path );
+/**
+ * @brief Flush all buffered events and stop tracing
+ *
+ * Tracing is stopped even on failure.
+ *
+ * @return 0 on success, otherwise -1 and errno is set, also if any events
+ *         could not be written since gpio_trace_start()
+ */
+int gpio_trace_stop( void );
+
+/**
+ * @brief Convert a binary trace file to Chrome trace / Perfetto JSON
+ *
+ * Files of any version up to GPIO_TRACE_VERSION are accepted, and arguments
+ * are named after what they hold in that version.
+ *
+ * @param in   the binary trace file
+ * @param out  the JSON file, truncated if it exists
+ * @return the number of events converted, otherwise -1 and errno is set
+ */
+int gpio_trace_to_json( const char *in, const char *out );
+
+uint64_t gpio_trace_now( void );
+void gpio_trace_record( unsigned op, uint16_t gpio, int32_t arg0, int32_t arg1, uint64_t start_ns, bool failed );
+
+__END_DECLS
+
+#endif // LIBGPIO_GPIOTRACE_H_
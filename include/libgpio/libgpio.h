@@ -27,6 +27,7 @@
 
 #include <sys/cdefs.h>
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -55,6 +56,22 @@ typedef enum {
 	GPIO_EDGE_BOTH,
 } gpio_edge_t;
 
+/**
+ * @brief Override the sysfs GPIO class directory
+ *
+ * All paths used by libgpio are relative to this directory, which defaults to
+ * /sys/class/gpio. Pointing it elsewhere is mainly useful for exercising the
+ * library against a simulated sysfs tree.
+ *
+ * @param root  the new directory, or NULL to restore the default
+ * @return 0 on success, otherwise -1 and errno is set
+ */
+int gpio_sysfs_root_set( const char *root );
+/**
+ * @brief The sysfs GPIO class directory currently in use
+ */
+const char *gpio_sysfs_root_get( void );
+
 int gpio_direction_set( uint16_t gpio, gpio_direction_t *output );
 int gpio_direction_get( uint16_t gpio, gpio_direction_t *output );
 
@@ -64,10 +81,69 @@ int gpio_value_get( uint16_t gpio, gpio_value_t *high );
 int gpio_edge_set( uint16_t gpio, gpio_edge_t *edge );
 int gpio_edge_get( uint16_t gpio, gpio_edge_t *edge );
 
+/**
+ * @brief Open a property of an exported GPIO for repeated access
+ *
+ * Reading or writing through a cached descriptor avoids the open(2) and
+ * close(2) that every gpio_*_get() and gpio_*_set() call implies.
+ *
+ * @param gpio  the GPIO number
+ * @param prop  the property
+ * @return a file descriptor to be closed by the caller, otherwise -1 and
+ *         errno is set
+ */
+int gpio_prop_open( uint16_t gpio, gpio_prop_t prop );
+/**
+ * @brief Write a property through a descriptor from gpio_prop_open()
+ *
+ * @param fd    the file descriptor
+ * @param prop  the property @p fd was opened for
+ * @param val   a gpio_value_t, gpio_direction_t or gpio_edge_t, matching @p prop
+ * @return 0 on success, otherwise -1 and errno is set
+ */
+int gpio_prop_write( int fd, gpio_prop_t prop, unsigned val );
+/**
+ * @brief Read a property through a descriptor from gpio_prop_open()
+ *
+ * @param fd    the file descriptor
+ * @param prop  the property @p fd was opened for
+ * @param val   storage for a gpio_value_t, gpio_direction_t or gpio_edge_t
+ * @return 0 on success, otherwise -1 and errno is set
+ */
+int gpio_prop_read( int fd, gpio_prop_t prop, unsigned *val );
+
 bool gpio_is_exported( uint16_t gpio );
 int gpio_export( uint16_t gpio );
 int gpio_unexport( uint16_t gpio );
 
+#define GPIO_EXPORT_TIMEOUT_MS_DEFAULT 1000
+
+/**
+ * @brief Export several GPIOs and wait until they are usable
+ *
+ * All exports are issued up front. The call then waits, using inotify rather
+ * than polling, until each gpioN/value exists and is writable by the caller,
+ * e.g. after udev has adjusted its permissions.
+ *
+ * GPIOs that are already exported are not exported again, but are still
+ * waited upon.
+ *
+ * @param gpio        the GPIO numbers
+ * @param n           the number of GPIO numbers
+ * @param timeout_ms  overall deadline in milliseconds, or -1 to wait forever
+ * @param err         per-GPIO errno, 0 on success and ETIMEDOUT if the GPIO
+ *                    did not become ready in time (may be NULL)
+ * @return 0 if every GPIO is ready, otherwise -1 and errno is set to the
+ *         error of the first GPIO that failed
+ */
+int gpio_export_bulk( const uint16_t *gpio, size_t n, int timeout_ms, int *err );
+/**
+ * @brief Export a single GPIO and wait until it is usable
+ *
+ * @see gpio_export_bulk
+ */
+int gpio_export_wait( uint16_t gpio, int timeout_ms );
+
 __END_DECLS
 
 #endif // LIBGPIO_LIBGPIO_H_
@@ -29,12 +29,15 @@
 #include <fcntl.h>
 #include <sys/socket.h>
 #include <poll.h>
+#include <limits.h>
 
 #include <algorithm>
 #include <iostream>
+#include <cstdlib>
 #include <cstring>
 
 #include "libgpio/Gpio.h"
+#include "libgpio/gpiotrace.h"
 
 using namespace ::std;
 using namespace ::com::github::cfriedt;
@@ -43,96 +46,148 @@ using namespace ::com::github::cfriedt;
 #define ARRAY_SIZE( x ) ( sizeof( x ) / sizeof( (x)[ 0 ] ))
 #endif
 
-Gpio::Gpio( unsigned num, gpio_value_t value )
+namespace {
+// records a traced operation when it goes out of scope, including by throwing
+struct GpioTraceScope {
+	unsigned op;
+	uint16_t gpio;
+	int32_t arg;
+	const std::error_code &ec;
+	uint64_t t;
+	GpioTraceScope( unsigned op, uint16_t gpio, int32_t arg, const std::error_code &ec )
+	:
+		op( op ),
+		gpio( gpio ),
+		arg( arg ),
+		ec( ec ),
+		t( GPIO_TRACE_ENABLED() ? gpio_trace_now() : 0 )
+	{
+	}
+	~GpioTraceScope() {
+		int err;
+		if ( 0 == t ) {
+			return;
+		}
+		// gpio_trace_record() takes the error from errno
+		err = errno;
+		errno = ec.value();
+		GPIO_TRACE_END( t, op, gpio, arg, 0, ec ? -1 : EXIT_SUCCESS );
+		errno = err;
+	}
+};
+
+// the timeout recorded for a wait, -1 meaning forever
+int32_t trace_timeout_us( const std::chrono::steady_clock::time_point *deadline ) {
+	int64_t us;
+
+	if ( NULL == deadline ) {
+		return -1;
+	}
+	us = std::chrono::duration_cast<std::chrono::microseconds>( *deadline - std::chrono::steady_clock::now() ).count();
+	return std::min<int64_t>( INT32_MAX, std::max<int64_t>( 0, us ) );
+}
+
+std::error_code last_error() {
+	return std::error_code( errno, std::system_category() );
+}
+
+void throw_if( const std::error_code &ec ) {
+	if ( ec ) {
+		throw std::system_error( ec );
+	}
+}
+}
+
+Gpio::Gpio( unsigned num, gpio_value_t value, std::error_code &ec, Ownership ownership ) noexcept
 :
 	gpio_num( num ),
 	gpio_edge( GPIO_EDGE_NONE ),
+	gpio_ownership( ownership ),
+	gpio_exported_here( false ),
 	sys_class_gpio_gpio_n_value_fd( -1 ),
 	interruptee_fd( -1 ),
 	interruptor_fd( -1 )
 {
-	int r;
-	gpio_direction_t direction;
-
-	if ( ! gpio_is_exported( num ) ) {
-		r = gpio_export( num );
-		if ( -1 == r ) {
-			throw std::system_error( errno, std::system_category() );
-		}
-	}
-
-	direction = GPIO_DIR_OUT;
-	r = gpio_direction_set( num, & direction );
-	if ( -1 == r ) {
-		throw std::system_error( errno, std::system_category() );
-	}
-
-	r = gpio_value_set( num, &value );
-	if ( -1 == r ) {
-		throw std::system_error( errno, std::system_category() );
-	}
+	init_out( value, ec );
 }
 
-Gpio::Gpio( unsigned num, gpio_edge_t edge )
+Gpio::Gpio( unsigned num, gpio_edge_t edge, std::error_code &ec, Ownership ownership ) noexcept
 :
 	gpio_num( num ),
 	gpio_edge( edge ),
+	gpio_ownership( ownership ),
+	gpio_exported_here( false ),
 	sys_class_gpio_gpio_n_value_fd( -1 ),
 	interruptee_fd( -1 ),
 	interruptor_fd( -1 )
 {
-	int r;
-	gpio_direction_t direction;
-
-	if ( ! gpio_is_exported( num ) ) {
-		r = gpio_export( num );
-		if ( -1 == r ) {
-			throw std::system_error( errno, std::system_category() );
-		}
-	}
-
-	direction = GPIO_DIR_IN;
-	r = gpio_direction_set( num, & direction );
-	if ( -1 == r ) {
-		throw std::system_error( errno, std::system_category() );
-	}
-
-	r = gpio_edge_set( num, & edge );
-	if ( -1 == r ) {
-		throw std::system_error( errno, std::system_category() );
-	}
+	init_in( ec );
 }
 
-Gpio::Gpio( unsigned num )
+Gpio::Gpio( unsigned num, std::error_code &ec, Ownership ownership ) noexcept
 :
 	gpio_num( num ),
 	gpio_edge( GPIO_EDGE_NONE ),
+	gpio_ownership( ownership ),
+	gpio_exported_here( false ),
 	sys_class_gpio_gpio_n_value_fd( -1 ),
 	interruptee_fd( -1 ),
 	interruptor_fd( -1 )
 {
-	int r;
-
-	gpio_direction_t direction;
+	init_in( ec );
+}
 
-	export_();
+Gpio::Gpio( unsigned num, gpio_value_t value, Ownership ownership )
+:
+	gpio_num( num ),
+	gpio_edge( GPIO_EDGE_NONE ),
+	gpio_ownership( ownership ),
+	gpio_exported_here( false ),
+	sys_class_gpio_gpio_n_value_fd( -1 ),
+	interruptee_fd( -1 ),
+	interruptor_fd( -1 )
+{
+	std::error_code ec;
+	init_out( value, ec );
+	throw_if( ec );
+}
 
-	direction = GPIO_DIR_IN;
-	r = gpio_direction_set( num, & direction );
-	if ( -1 == r ) {
-		throw std::system_error( errno, std::system_category() );
-	}
+Gpio::Gpio( unsigned num, gpio_edge_t edge, Ownership ownership )
+:
+	gpio_num( num ),
+	gpio_edge( edge ),
+	gpio_ownership( ownership ),
+	gpio_exported_here( false ),
+	sys_class_gpio_gpio_n_value_fd( -1 ),
+	interruptee_fd( -1 ),
+	interruptor_fd( -1 )
+{
+	std::error_code ec;
+	init_in( ec );
+	throw_if( ec );
+}
 
-	r = gpio_edge_set( num, & gpio_edge );
-	if ( -1 == r ) {
-		throw std::system_error( errno, std::system_category() );
-	}
+Gpio::Gpio( unsigned num, Ownership ownership )
+:
+	gpio_num( num ),
+	gpio_edge( GPIO_EDGE_NONE ),
+	gpio_ownership( ownership ),
+	gpio_exported_here( false ),
+	sys_class_gpio_gpio_n_value_fd( -1 ),
+	interruptee_fd( -1 ),
+	interruptor_fd( -1 )
+{
+	std::error_code ec;
+	init_in( ec );
+	throw_if( ec );
 }
 
 Gpio::Gpio()
 :
 	gpio_num( -1 ),
 	gpio_edge( GPIO_EDGE_NONE ),
+	gpio_ownership( UNEXPORT_ON_DESTROY ),
+	gpio_exported_here( false ),
 	sys_class_gpio_gpio_n_value_fd( -1 ),
 	interruptee_fd( -1 ),
 	interruptor_fd( -1 )
@@ -144,95 +199,354 @@ Gpio::~Gpio() {
 	// XXX: TODO: should we unconditionally set the pin back to input?
 
 	interrupt();
-	if ( gpio_is_exported( gpio_num ) ) {
-		gpio_unexport( gpio_num );
+	if ( UNEXPORT_ON_DESTROY == gpio_ownership || ( UNEXPORT_IF_EXPORTED_HERE == gpio_ownership && gpio_exported_here ) ) {
+		if ( gpio_is_exported( gpio_num ) ) {
+			gpio_unexport( gpio_num );
+		}
 	}
 	close_fds();
 }
 
+bool Gpio::claim( std::error_code &ec ) noexcept {
+	int r;
+
+	ec.clear();
+
+	if ( gpio_is_exported( gpio_num ) ) {
+		return true;
+	}
+
+	r = gpio_export_wait( gpio_num, GPIO_EXPORT_TIMEOUT_MS_DEFAULT );
+	if ( -1 == r ) {
+		ec = last_error();
+		return false;
+	}
+	gpio_exported_here = true;
+
+	return false;
+}
+
+void Gpio::init_out( gpio_value_t value, std::error_code &ec ) noexcept {
+	int r;
+	bool existing;
+	gpio_direction_t direction;
+	gpio_value_t current;
+
+	existing = claim( ec );
+	if ( ec ) {
+		return;
+	}
+
+	// an existing configuration is only rewritten where it differs
+	if ( ! existing || -1 == gpio_direction_get( gpio_num, & direction ) || GPIO_DIR_OUT != direction ) {
+		direction = GPIO_DIR_OUT;
+		r = gpio_direction_set( gpio_num, & direction );
+		if ( -1 == r ) {
+			ec = last_error();
+			return;
+		}
+		// switching to "out" drives the line low
+		existing = false;
+	}
+
+	if ( ! existing || -1 == gpio_value_get( gpio_num, & current ) || value != current ) {
+		r = gpio_value_set( gpio_num, &value );
+		if ( -1 == r ) {
+			ec = last_error();
+			return;
+		}
+	}
+}
+
+void Gpio::init_in( std::error_code &ec ) noexcept {
+	int r;
+	bool existing;
+	gpio_direction_t direction;
+	gpio_edge_t edge;
+
+	existing = claim( ec );
+	if ( ec ) {
+		return;
+	}
+
+	// an existing configuration is only rewritten where it differs
+	if ( ! existing || -1 == gpio_direction_get( gpio_num, & direction ) || GPIO_DIR_IN != direction ) {
+		direction = GPIO_DIR_IN;
+		r = gpio_direction_set( gpio_num, & direction );
+		if ( -1 == r ) {
+			ec = last_error();
+			return;
+		}
+	}
+
+	if ( ! existing || -1 == gpio_edge_get( gpio_num, & edge ) || gpio_edge != edge ) {
+		r = gpio_edge_set( gpio_num, & gpio_edge );
+		if ( -1 == r ) {
+			ec = last_error();
+			return;
+		}
+	}
+}
+
+std::vector<std::error_code> Gpio::export_all( const std::vector<uint16_t> &nums, int timeout_ms ) {
+	int r;
+	std::vector<int> err( nums.size() );
+	std::vector<std::error_code> ec( nums.size() );
+
+	r = gpio_export_bulk( nums.data(), nums.size(), timeout_ms, err.data() );
+	if ( -1 == r ) {
+		for( size_t i = 0; i < nums.size(); i++ ) {
+			ec[ i ] = std::error_code( err[ i ], std::system_category() );
+		}
+	}
+
+	return ec;
+}
+
 uint16_t Gpio::num() {
 	return gpio_num;
 }
 
-gpio_value_t Gpio::value() {
+Gpio::Ownership Gpio::ownership() {
+	return gpio_ownership;
+}
+void Gpio::ownership( Ownership ownership ) {
+	gpio_ownership = ownership;
+}
+bool Gpio::exported_here() {
+	return gpio_exported_here;
+}
+
+gpio_value_t Gpio::value( std::error_code &ec ) noexcept {
 	gpio_value_t r;
 	int rr;
 
-	export_();
+	r = GPIO_VALUE_LOW;
+
+	export_( ec );
+	if ( ec ) {
+		return r;
+	}
 
 	rr = gpio_value_get( gpio_num, &r );
 	if ( -1 == rr ) {
-		throw std::system_error( errno, std::system_category() );
+		ec = last_error();
 	}
 
 	return r;
 }
-void Gpio::value( gpio_value_t value ) {
+void Gpio::value( gpio_value_t value, std::error_code &ec ) noexcept {
 	int r;
 
-	export_();
+	export_( ec );
+	if ( ec ) {
+		return;
+	}
 
 	r = gpio_value_set( gpio_num, &value );
 	if ( -1 == r ) {
-		throw std::system_error( errno, std::system_category() );
+		ec = last_error();
 	}
 }
+gpio_value_t Gpio::value() {
+	gpio_value_t r;
+	std::error_code ec;
 
-gpio_direction_t Gpio::direction() {
+	r = value( ec );
+	throw_if( ec );
+
+	return r;
+}
+void Gpio::value( gpio_value_t value ) {
+	std::error_code ec;
+
+	this->value( value, ec );
+	throw_if( ec );
+}
+
+gpio_direction_t Gpio::direction( std::error_code &ec ) noexcept {
 	gpio_direction_t r;
 	int rr;
 
-	export_();
+	r = GPIO_DIR_IN;
+
+	export_( ec );
+	if ( ec ) {
+		return r;
+	}
 
 	rr = gpio_direction_get( gpio_num, &r );
 	if ( -1 == rr ) {
-		throw std::system_error( errno, std::system_category() );
+		ec = last_error();
 	}
 
 	return r;
 }
-
-void Gpio::direction( gpio_direction_t direction ) {
+void Gpio::direction( gpio_direction_t direction, std::error_code &ec ) noexcept {
 	int r;
 
-	export_();
+	export_( ec );
+	if ( ec ) {
+		return;
+	}
 
 	r = gpio_direction_set( gpio_num, &direction );
 	if ( -1 == r ) {
-		throw std::system_error( errno, std::system_category() );
+		ec = last_error();
 	}
 }
+gpio_direction_t Gpio::direction() {
+	gpio_direction_t r;
+	std::error_code ec;
 
-gpio_edge_t Gpio::edge() {
+	r = direction( ec );
+	throw_if( ec );
+
+	return r;
+}
+void Gpio::direction( gpio_direction_t direction ) {
+	std::error_code ec;
+
+	this->direction( direction, ec );
+	throw_if( ec );
+}
+
+gpio_edge_t Gpio::edge( std::error_code &ec ) noexcept {
 	gpio_edge_t r;
 	int rr;
 
-	export_();
+	r = GPIO_EDGE_NONE;
+
+	export_( ec );
+	if ( ec ) {
+		return r;
+	}
 
 	rr = gpio_edge_get( gpio_num, &r );
 	if ( -1 == rr ) {
-		throw std::system_error( errno, std::system_category() );
+		ec = last_error();
 	}
 
 	return r;
 }
-void Gpio::edge( gpio_edge_t edge ) {
+void Gpio::edge( gpio_edge_t edge, std::error_code &ec ) noexcept {
 	int r;
 
-	export_();
+	export_( ec );
+	if ( ec ) {
+		return;
+	}
 
 	gpio_edge = edge;
 
 	r = gpio_edge_set( gpio_num, &edge );
 	if ( -1 == r ) {
-		throw std::system_error( errno, std::system_category() );
+		ec = last_error();
 	}
 }
+gpio_edge_t Gpio::edge() {
+	gpio_edge_t r;
+	std::error_code ec;
+
+	r = edge( ec );
+	throw_if( ec );
+
+	return r;
+}
+void Gpio::edge( gpio_edge_t edge ) {
+	std::error_code ec;
+
+	this->edge( edge, ec );
+	throw_if( ec );
+}
 
 void Gpio::wait() {
-	wait( -1 );
+	std::error_code ec;
+
+	wait( ec );
+	throw_if( ec );
+}
+void Gpio::wait( std::error_code &ec ) noexcept {
+	wait_( NULL, NULL, ec );
 }
 void Gpio::wait( uint16_t ms ) {
+	wait_for( std::chrono::milliseconds( ms ) );
+}
+void Gpio::wait( uint16_t ms, std::error_code &ec ) noexcept {
+	wait_for( std::chrono::milliseconds( ms ), ec );
+}
+
+void Gpio::wait_for( std::chrono::nanoseconds timeout ) {
+	wait_until( std::chrono::steady_clock::now() + timeout );
+}
+void Gpio::wait_for( std::chrono::nanoseconds timeout, std::error_code &ec ) noexcept {
+	wait_until( std::chrono::steady_clock::now() + timeout, ec );
+}
+
+void Gpio::wait_until( std::chrono::steady_clock::time_point deadline ) {
+	std::error_code ec;
+
+	wait_until( deadline, ec );
+	throw_if( ec );
+}
+void Gpio::wait_until( std::chrono::steady_clock::time_point deadline, std::error_code &ec ) noexcept {
+	wait_( & deadline, NULL, ec );
+}
+
+void Gpio::wait( GpioEvent &event ) {
+	std::error_code ec;
+
+	wait( event, ec );
+	throw_if( ec );
+}
+void Gpio::wait( GpioEvent &event, std::error_code &ec ) noexcept {
+	wait_( NULL, & event, ec );
+}
+
+void Gpio::wait_for( std::chrono::nanoseconds timeout, GpioEvent &event ) {
+	wait_until( std::chrono::steady_clock::now() + timeout, event );
+}
+void Gpio::wait_for( std::chrono::nanoseconds timeout, GpioEvent &event, std::error_code &ec ) noexcept {
+	wait_until( std::chrono::steady_clock::now() + timeout, event, ec );
+}
+
+void Gpio::wait_until( std::chrono::steady_clock::time_point deadline, GpioEvent &event ) {
+	std::error_code ec;
+
+	wait_until( deadline, event, ec );
+	throw_if( ec );
+}
+void Gpio::wait_until( std::chrono::steady_clock::time_point deadline, GpioEvent &event, std::error_code &ec ) noexcept {
+	wait_( & deadline, & event, ec );
+}
+
+void Gpio::read_event( std::chrono::steady_clock::time_point timestamp, GpioEvent &event, std::error_code &ec ) noexcept {
+	int r;
+	char buf[ 16 ];
+
+	r = pread( sys_class_gpio_gpio_n_value_fd, buf, sizeof( buf ), 0 );
+	if ( -1 == r ) {
+		ec = last_error();
+		return;
+	}
+	if ( 0 == r ) {
+		ec = std::error_code( EIO, std::system_category() );
+		return;
+	}
+
+	event.num = gpio_num;
+	event.value = '1' == buf[ 0 ] ? GPIO_VALUE_HIGH : GPIO_VALUE_LOW;
+	if ( GPIO_EDGE_RISING == gpio_edge || GPIO_EDGE_FALLING == gpio_edge ) {
+		event.edge = gpio_edge;
+	} else {
+		event.edge = GPIO_VALUE_HIGH == event.value ? GPIO_EDGE_RISING : GPIO_EDGE_FALLING;
+	}
+	event.timestamp = timestamp;
+	event.count = 1;
+	ec.clear();
+}
+
+void Gpio::wait_( const std::chrono::steady_clock::time_point *deadline, GpioEvent *event, std::error_code &ec ) noexcept {
 
 	enum {
 		INTERRUPTEE,
@@ -241,35 +555,45 @@ void Gpio::wait( uint16_t ms ) {
 
 	int r;
 	int sv[2];
-	char path[ 64 ];
+	char path[ PATH_MAX ];
 
 	struct pollfd pollfd[2];
+	struct timespec ts;
+	std::chrono::nanoseconds remaining;
 
-	export_();
+	GpioTraceScope trace( GPIO_TRACE_OP_WAIT, gpio_num, GPIO_TRACE_ENABLED() ? trace_timeout_us( deadline ) : 0, ec );
+
+	export_( ec );
+	if ( ec ) {
+		return;
+	}
 
 	r = socketpair( AF_UNIX, SOCK_STREAM, 0, sv );
 	if ( -1 == r ) {
+		ec = last_error();
 		close_fds();
-		throw std::system_error( errno, std::system_category() );
+		return;
 	}
 
 	interruptee_fd = sv[ INTERRUPTEE ];
 	interruptor_fd = sv[ INTERRUPTOR ];
 
 	memset( path, 0, sizeof( path ) );
-	snprintf( path, sizeof( path ) - 1, "/sys/class/gpio/gpio%u/value", gpio_num );
+	snprintf( path, sizeof( path ) - 1, "%s/gpio%u/value", gpio_sysfs_root_get(), gpio_num );
 
 	r = open( path, O_RDWR );
 	if ( -1 == r ) {
+		ec = last_error();
 		close_fds();
-		throw std::system_error( errno, std::system_category() );
+		return;
 	}
 	sys_class_gpio_gpio_n_value_fd = r;
 
 	r = read( sys_class_gpio_gpio_n_value_fd, path, sizeof( path ) );
 	if ( -1 == r ) {
+		ec = last_error();
 		close_fds();
-		throw std::system_error( errno, std::system_category() );
+		return;
 	}
 
 	pollfd[ 0 ].fd = sys_class_gpio_gpio_n_value_fd;
@@ -278,31 +602,58 @@ void Gpio::wait( uint16_t ms ) {
 	pollfd[ 1 ].fd = interruptee_fd;
 	pollfd[ 1 ].events = POLLIN;
 
-	r = poll( pollfd, ARRAY_SIZE( pollfd ), ms );
-	if ( -1 == r ) {
-		close_fds();
-		throw std::system_error( errno, std::system_category() );
-	}
-	if ( 0 == r ) {
-		close_fds();
-		errno = ETIMEDOUT;
-		throw std::system_error( errno, std::system_category() );
-	}
-	if ( pollfd[ 1 ].revents & POLLIN ) {
-		close_fds();
-		errno = EINTR;
-		throw std::system_error( errno, std::system_category() );
-	}
-	if ( pollfd[ 0 ].revents & POLLPRI ) {
-		// received gpio interrupt
+	for( ;; ) {
+
+		if ( NULL != deadline ) {
+			// recomputed from the absolute deadline on every pass, so signals and
+			// spurious wakeups do not stretch the wait
+			remaining = std::max( std::chrono::nanoseconds::zero(), std::chrono::duration_cast<std::chrono::nanoseconds>( *deadline - std::chrono::steady_clock::now() ) );
+			ts.tv_sec = remaining.count() / 1000000000;
+			ts.tv_nsec = remaining.count() % 1000000000;
+		}
+
+		r = ppoll( pollfd, ARRAY_SIZE( pollfd ), NULL == deadline ? NULL : & ts, NULL );
+		if ( -1 == r ) {
+			if ( EINTR == errno ) {
+				continue;
+			}
+			ec = last_error();
+			break;
+		}
+		if ( pollfd[ 1 ].revents & POLLIN ) {
+			ec = std::error_code( EINTR, std::system_category() );
+			break;
+		}
+		if ( pollfd[ 0 ].revents & POLLPRI ) {
+			// received gpio interrupt
+			if ( NULL != event ) {
+				read_event( std::chrono::steady_clock::now(), *event, ec );
+			} else {
+				ec.clear();
+			}
+			break;
+		}
+		if ( ( pollfd[ 0 ].revents | pollfd[ 1 ].revents ) & POLLNVAL ) {
+			ec = std::error_code( EBADF, std::system_category() );
+			break;
+		}
+		if ( NULL != deadline && std::chrono::steady_clock::now() >= *deadline ) {
+			ec = std::error_code( ETIMEDOUT, std::system_category() );
+			break;
+		}
 	}
+
 	close_fds();
 }
 
 void Gpio::interrupt() {
 	const char *foo = "!";
+	std::error_code ec;
+	GpioTraceScope trace( GPIO_TRACE_OP_INTERRUPT, gpio_num, interruptor_fd, ec );
 	if ( -1 != interruptor_fd ) {
-		write( interruptor_fd, foo, strlen( foo ) );
+		if ( -1 == write( interruptor_fd, foo, strlen( foo ) ) ) {
+			ec = last_error();
+		}
 	}
 }
 
@@ -325,28 +676,51 @@ bool Gpio::is_exported() {
 	return gpio_is_exported( gpio_num );
 }
 
-void Gpio::export_() {
+void Gpio::export_( std::error_code &ec ) noexcept {
 	int r;
+
+	ec.clear();
+
 	if ( ! is_exported() ) {
-		r = gpio_export( gpio_num );
+		r = gpio_export_wait( gpio_num, GPIO_EXPORT_TIMEOUT_MS_DEFAULT );
 		if ( -1 == r ) {
-			throw std::system_error( errno, std::system_category() );
+			ec = last_error();
+			return;
 		}
+		gpio_exported_here = true;
 		if ( GPIO_EDGE_NONE != gpio_edge ) {
-			edge( gpio_edge );
+			edge( gpio_edge, ec );
 		}
 	}
 }
+void Gpio::export_() {
+	std::error_code ec;
 
-void Gpio::unexport() {
+	export_( ec );
+	throw_if( ec );
+}
+
+void Gpio::unexport( std::error_code &ec ) noexcept {
 	int r;
+
+	ec.clear();
+
 	if ( is_exported() ) {
-		if ( GPIO_EDGE_NONE != edge() ) {
-			edge( GPIO_EDGE_NONE );
+		if ( GPIO_EDGE_NONE != edge( ec ) ) {
+			edge( GPIO_EDGE_NONE, ec );
+		}
+		if ( ec ) {
+			return;
 		}
 		r = gpio_unexport( gpio_num );
 		if ( -1 == r ) {
-			throw std::system_error( errno, std::system_category() );
+			ec = last_error();
 		}
 	}
 }
+void Gpio::unexport() {
+	std::error_code ec;
+
+	unexport( ec );
+	throw_if( ec );
+}
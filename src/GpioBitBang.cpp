@@ -0,0 +1,363 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include "libgpio/GpioBitBang.h"
+
+using namespace ::std;
+using namespace ::com::github::cfriedt;
+
+GpioBitBang::GpioBitBang()
+:
+	last_bits( 0 ),
+	last_steps( 0 ),
+	last_elapsed( std::chrono::nanoseconds::zero() )
+{
+}
+
+GpioBitBang::~GpioBitBang() {
+	for( auto & line: lines ) {
+		if ( -1 != line.value_fd ) {
+			close( line.value_fd );
+		}
+		if ( -1 != line.direction_fd ) {
+			close( line.direction_fd );
+		}
+	}
+}
+
+double GpioBitBang::bits_per_second() {
+	if ( 0 == last_elapsed.count() ) {
+		return 0;
+	}
+	return last_bits * 1e9 / last_elapsed.count();
+}
+
+size_t GpioBitBang::steps() {
+	return last_steps;
+}
+
+size_t GpioBitBang::output( uint16_t num, gpio_value_t level, bool open_drain ) {
+	Line line;
+
+	line.gpio.reset( open_drain ? new Gpio( num ) : new Gpio( num, level ) );
+	line.value_fd = -1;
+	line.direction_fd = -1;
+	line.open_drain = open_drain;
+	line.level = open_drain ? GPIO_VALUE_HIGH : level;
+
+	line.value_fd = gpio_prop_open( num, GPIO_PROP_VALUE );
+	if ( -1 == line.value_fd ) {
+		throw std::system_error( errno, std::system_category() );
+	}
+	if ( open_drain ) {
+		line.direction_fd = gpio_prop_open( num, GPIO_PROP_DIRECTION );
+		if ( -1 == line.direction_fd ) {
+			int e = errno;
+			close( line.value_fd );
+			throw std::system_error( e, std::system_category() );
+		}
+	}
+
+	lines.push_back( std::move( line ) );
+
+	if ( open_drain && GPIO_VALUE_LOW == level ) {
+		set( lines.size() - 1, GPIO_VALUE_LOW );
+		execute( NULL, 0 );
+	}
+
+	return lines.size() - 1;
+}
+
+size_t GpioBitBang::input( uint16_t num ) {
+	Line line;
+
+	line.gpio.reset( new Gpio( num ) );
+	line.value_fd = -1;
+	line.direction_fd = -1;
+	line.open_drain = false;
+	line.level = -1;
+
+	line.value_fd = gpio_prop_open( num, GPIO_PROP_VALUE );
+	if ( -1 == line.value_fd ) {
+		throw std::system_error( errno, std::system_category() );
+	}
+
+	lines.push_back( std::move( line ) );
+
+	return lines.size() - 1;
+}
+
+void GpioBitBang::set( size_t line, int level ) {
+	Line & l = lines[ line ];
+	Step step;
+
+	if ( level == l.level ) {
+		return;
+	}
+	l.level = level;
+
+	if ( l.open_drain ) {
+		step.fd = l.direction_fd;
+		step.prop = GPIO_PROP_DIRECTION;
+		// "out" drives the line low
+		step.val = level ? GPIO_DIR_IN : GPIO_DIR_OUT;
+	} else {
+		step.fd = l.value_fd;
+		step.prop = GPIO_PROP_VALUE;
+		step.val = level ? GPIO_VALUE_HIGH : GPIO_VALUE_LOW;
+	}
+	step.bit = -1;
+
+	program.push_back( step );
+}
+
+void GpioBitBang::sample( size_t line, size_t bit ) {
+	Step step;
+
+	step.fd = lines[ line ].value_fd;
+	step.prop = GPIO_PROP_VALUE;
+	step.val = 0;
+	step.bit = bit;
+
+	program.push_back( step );
+}
+
+void GpioBitBang::execute( uint8_t *rx, size_t payload ) {
+	int r;
+	unsigned val;
+	std::chrono::steady_clock::time_point start;
+
+	start = std::chrono::steady_clock::now();
+
+	for( auto & step: program ) {
+		if ( step.bit < 0 ) {
+			r = gpio_prop_write( step.fd, step.prop, step.val );
+		} else {
+			r = gpio_prop_read( step.fd, step.prop, & val );
+			if ( EXIT_SUCCESS == r && GPIO_VALUE_HIGH == val ) {
+				rx[ step.bit / 8 ] |= 0x80 >> ( step.bit % 8 );
+			}
+		}
+		if ( -1 == r ) {
+			r = errno;
+			program.clear();
+			// the levels assumed while compiling no longer hold
+			for( auto & line: lines ) {
+				line.level = -1;
+			}
+			throw std::system_error( r, std::system_category() );
+		}
+	}
+
+	last_elapsed = std::chrono::steady_clock::now() - start;
+	last_bits = payload;
+	last_steps = program.size();
+
+	program.clear();
+}
+
+GpioSpi::GpioSpi( uint16_t sclk, uint16_t mosi, int miso, int cs, unsigned mode )
+:
+	mode( mode ),
+	miso( NONE ),
+	cs( NONE )
+{
+	if ( mode > 3 ) {
+		throw std::system_error( EINVAL, std::system_category() );
+	}
+
+	this->sclk = output( sclk, mode & 2 ? GPIO_VALUE_HIGH : GPIO_VALUE_LOW );
+	this->mosi = output( mosi, GPIO_VALUE_LOW );
+	if ( NONE != miso ) {
+		this->miso = input( miso );
+	}
+	if ( NONE != cs ) {
+		this->cs = output( cs, GPIO_VALUE_HIGH );
+	}
+}
+
+GpioSpi::~GpioSpi() {
+}
+
+void GpioSpi::transfer( const uint8_t *tx, uint8_t *rx, size_t len ) {
+	int idle;
+	int active;
+	int b;
+	std::vector<uint8_t> scratch;
+
+	idle = mode & 2 ? 1 : 0;
+	active = ! idle;
+
+	if ( NULL == rx && NONE != miso ) {
+		scratch.resize( len );
+		rx = scratch.data();
+	}
+	if ( NULL != rx ) {
+		memset( rx, 0, len );
+	}
+
+	if ( NONE != cs ) {
+		set( cs, 0 );
+	}
+	set( sclk, idle );
+
+	for( size_t i = 0; i < 8 * len; i++ ) {
+		b = NULL == tx ? 0 : ( tx[ i / 8 ] >> ( 7 - i % 8 ) ) & 1;
+		if ( mode & 1 ) {
+			// CPHA = 1: shift out on the leading edge, sample on the trailing edge
+			set( sclk, active );
+			set( mosi, b );
+			set( sclk, idle );
+			if ( NONE != miso ) {
+				sample( miso, i );
+			}
+		} else {
+			// CPHA = 0: shift out before the leading edge, sample after it
+			set( mosi, b );
+			set( sclk, active );
+			if ( NONE != miso ) {
+				sample( miso, i );
+			}
+			set( sclk, idle );
+		}
+	}
+
+	if ( NONE != cs ) {
+		set( cs, 1 );
+	}
+
+	execute( rx, 8 * len );
+}
+
+GpioI2c::GpioI2c( uint16_t scl, uint16_t sda )
+{
+	this->scl = output( scl, GPIO_VALUE_HIGH, true );
+	this->sda = output( sda, GPIO_VALUE_HIGH, true );
+}
+
+GpioI2c::~GpioI2c() {
+}
+
+void GpioI2c::start() {
+	set( sda, 1 );
+	set( scl, 1 );
+	set( sda, 0 );
+	set( scl, 0 );
+}
+
+void GpioI2c::stop() {
+	set( sda, 0 );
+	set( scl, 1 );
+	set( sda, 1 );
+}
+
+void GpioI2c::byte_out( uint8_t byte, size_t ack_bit ) {
+	for( unsigned i = 0; i < 8; i++ ) {
+		set( sda, ( byte >> ( 7 - i ) ) & 1 );
+		set( scl, 1 );
+		set( scl, 0 );
+	}
+	set( sda, 1 );
+	set( scl, 1 );
+	sample( sda, ack_bit );
+	set( scl, 0 );
+}
+
+void GpioI2c::byte_in( size_t bit, bool ack ) {
+	set( sda, 1 );
+	for( unsigned i = 0; i < 8; i++ ) {
+		set( scl, 1 );
+		sample( sda, bit + i );
+		set( scl, 0 );
+	}
+	set( sda, ack ? 0 : 1 );
+	set( scl, 1 );
+	set( scl, 0 );
+}
+
+void GpioI2c::write( uint8_t addr, const uint8_t *data, size_t len ) {
+	// one acknowledge bit for the address and for each byte, low means ACK
+	std::vector<uint8_t> rx( ( len + 1 + 7 ) / 8 );
+
+	start();
+	byte_out( addr << 1, 0 );
+	for( size_t i = 0; i < len; i++ ) {
+		byte_out( data[ i ], 1 + i );
+	}
+	stop();
+
+	execute( rx.data(), 8 * ( len + 1 ) );
+
+	for( auto & b: rx ) {
+		if ( 0 != b ) {
+			throw std::system_error( ENXIO, std::system_category() );
+		}
+	}
+}
+
+void GpioI2c::read( uint8_t addr, uint8_t *data, size_t len ) {
+	// the address acknowledge in the first byte, data from the second on
+	std::vector<uint8_t> rx( 1 + len );
+
+	start();
+	byte_out( ( addr << 1 ) | 1, 0 );
+	for( size_t i = 0; i < len; i++ ) {
+		byte_in( 8 * ( 1 + i ), i + 1 < len );
+	}
+	stop();
+
+	execute( rx.data(), 8 * ( len + 1 ) );
+
+	if ( 0 != rx[ 0 ] ) {
+		throw std::system_error( ENXIO, std::system_category() );
+	}
+	memcpy( data, rx.data() + 1, len );
+}
+
+GpioShiftRegister::GpioShiftRegister( uint16_t data, uint16_t clock, uint16_t latch )
+{
+	this->data = output( data, GPIO_VALUE_LOW );
+	this->clock = output( clock, GPIO_VALUE_LOW );
+	this->latch = output( latch, GPIO_VALUE_LOW );
+}
+
+GpioShiftRegister::~GpioShiftRegister() {
+}
+
+void GpioShiftRegister::shift( const uint8_t *data, size_t len ) {
+	for( size_t i = 0; i < 8 * len; i++ ) {
+		set( this->data, ( data[ i / 8 ] >> ( 7 - i % 8 ) ) & 1 );
+		set( clock, 1 );
+		set( clock, 0 );
+	}
+	set( latch, 1 );
+	set( latch, 0 );
+
+	execute( NULL, 8 * len );
+}
@@ -0,0 +1,702 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include <limits.h>
+#include <stddef.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <linux/futex.h>
+
+#include <algorithm>
+#include <cstring>
+#include <system_error>
+
+#include "libgpio/GpioBroker.h"
+
+using namespace ::std;
+using namespace ::com::github::cfriedt;
+
+enum {
+	GPIO_BROKER_OP_CLAIM,
+	GPIO_BROKER_OP_RELEASE,
+	GPIO_BROKER_OP_SET,
+};
+
+typedef struct {
+	uint32_t op;
+	uint16_t num;
+	uint16_t value;
+	int32_t err;
+} gpio_broker_msg_t;
+
+static size_t shm_size_for( size_t npins ) {
+	return sizeof( GpioBrokerShm ) + ( std::max( npins, (size_t) 1 ) - 1 ) * sizeof( GpioBrokerPin );
+}
+
+static uint64_t now_ns() {
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, & ts );
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int futex( const std::atomic<uint32_t> *addr, int op, uint32_t val, const struct timespec *timeout ) {
+	return syscall( SYS_futex, const_cast<std::atomic<uint32_t> *>( addr ), op, val, timeout, NULL, 0 );
+}
+
+// a segment published by a broker that has since died
+static bool shm_stale( const std::string &name ) {
+	int fd;
+	struct stat st;
+	void *p;
+	bool r;
+
+	fd = shm_open( name.c_str(), O_RDONLY | O_CLOEXEC, 0 );
+	if ( -1 == fd ) {
+		return false;
+	}
+	if ( -1 == fstat( fd, & st ) || (size_t) st.st_size < sizeof( GpioBrokerShm ) ) {
+		close( fd );
+		return false;
+	}
+	p = mmap( NULL, sizeof( GpioBrokerShm ), PROT_READ, MAP_SHARED, fd, 0 );
+	close( fd );
+	if ( MAP_FAILED == p ) {
+		return false;
+	}
+	const GpioBrokerShm *shm = (const GpioBrokerShm *) p;
+	// the pid is filled in first, the magic last; either may be missing after a crash
+	r = shm->pid > 0 && -1 == kill( shm->pid, 0 ) && ESRCH == errno;
+	munmap( p, sizeof( GpioBrokerShm ) );
+
+	return r;
+}
+
+static int sockaddr_for( const std::string &path, struct sockaddr_un *addr ) {
+	memset( addr, 0, sizeof( *addr ) );
+	addr->sun_family = AF_UNIX;
+	if ( path.size() >= sizeof( addr->sun_path ) ) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	strncpy( addr->sun_path, path.c_str(), sizeof( addr->sun_path ) - 1 );
+	return EXIT_SUCCESS;
+}
+
+GpioBroker::GpioBroker( const std::string &shm_name, const std::string &socket_path )
+:
+	shm_name( shm_name ),
+	socket_path( socket_path ),
+	shm( NULL ),
+	shm_size( 0 ),
+	listen_fd( -1 ),
+	interruptee_fd( -1 ),
+	interruptor_fd( -1 ),
+	started( false )
+{
+	int r;
+	int sv[ 2 ];
+
+	r = socketpair( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0, sv );
+	if ( -1 == r ) {
+		throw std::system_error( errno, std::system_category() );
+	}
+	interruptee_fd = sv[ 0 ];
+	interruptor_fd = sv[ 1 ];
+}
+
+GpioBroker::~GpioBroker() {
+	stop();
+	close( interruptee_fd );
+	close( interruptor_fd );
+}
+
+void GpioBroker::add( uint16_t num, gpio_direction_t direction ) {
+	Pin pin;
+
+	if ( started || index.end() != index.find( num ) ) {
+		errno = started ? EBUSY : EEXIST;
+		throw std::system_error( errno, std::system_category() );
+	}
+
+	pin.num = num;
+	pin.direction = direction;
+	pin.exported_by_us = false;
+	pin.value_fd = -1;
+	pin.owner_fd = -1;
+
+	index[ num ] = pins.size();
+	pins.push_back( pin );
+}
+
+void GpioBroker::start() {
+	if ( started ) {
+		return;
+	}
+
+	try {
+		setup();
+	} catch( ... ) {
+		// leave nothing half-published behind, so start() may be retried
+		stop();
+		throw;
+	}
+
+	started = true;
+}
+
+void GpioBroker::setup() {
+	int r;
+	std::vector<uint16_t> nums;
+	char path[ PATH_MAX ];
+	char buf[ 16 ];
+	gpio_edge_t edge;
+	struct sockaddr_un addr;
+
+	// claim the segment before touching any GPIO, which another broker may be serving
+	shm_size = shm_size_for( pins.size() );
+	r = shm_open( shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0644 );
+	if ( -1 == r && EEXIST == errno && shm_stale( shm_name ) ) {
+		shm_unlink( shm_name.c_str() );
+		r = shm_open( shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0644 );
+	}
+	if ( -1 == r ) {
+		throw std::system_error( errno, std::system_category() );
+	}
+	if ( -1 == ftruncate( r, shm_size ) ) {
+		int e = errno;
+		close( r );
+		shm_unlink( shm_name.c_str() );
+		throw std::system_error( e, std::system_category() );
+	}
+	shm = (GpioBrokerShm *) mmap( NULL, shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, r, 0 );
+	close( r );
+	if ( MAP_FAILED == shm ) {
+		int e = errno;
+		shm = NULL;
+		shm_unlink( shm_name.c_str() );
+		throw std::system_error( e, std::system_category() );
+	}
+
+	shm->pid = getpid();
+
+	for( auto & pin: pins ) {
+		if ( ! gpio_is_exported( pin.num ) ) {
+			pin.exported_by_us = true;
+			nums.push_back( pin.num );
+		}
+	}
+	r = gpio_export_bulk( nums.data(), nums.size(), GPIO_EXPORT_TIMEOUT_MS_DEFAULT, NULL );
+	if ( -1 == r ) {
+		throw std::system_error( errno, std::system_category() );
+	}
+
+	for( auto & pin: pins ) {
+		r = gpio_direction_set( pin.num, & pin.direction );
+		if ( -1 == r ) {
+			throw std::system_error( errno, std::system_category() );
+		}
+		if ( GPIO_DIR_IN == pin.direction ) {
+			edge = GPIO_EDGE_BOTH;
+			r = gpio_edge_set( pin.num, & edge );
+			if ( -1 == r ) {
+				throw std::system_error( errno, std::system_category() );
+			}
+		}
+
+		memset( path, 0, sizeof( path ) );
+		snprintf( path, sizeof( path ) - 1, "%s/gpio%u/value", gpio_sysfs_root_get(), pin.num );
+		r = open( path, O_RDWR | O_CLOEXEC );
+		if ( -1 == r ) {
+			throw std::system_error( errno, std::system_category() );
+		}
+		pin.value_fd = r;
+	}
+
+	shm->npins = pins.size();
+	for( size_t i = 0; i < pins.size(); i++ ) {
+		shm->pin[ i ].num.store( pins[ i ].num, std::memory_order_relaxed );
+		shm->pin[ i ].direction.store( pins[ i ].direction, std::memory_order_relaxed );
+		r = pread( pins[ i ].value_fd, buf, sizeof( buf ), 0 );
+		if ( -1 == r ) {
+			throw std::system_error( errno, std::system_category() );
+		}
+		publish( i, r > 0 && '1' == buf[ 0 ] ? GPIO_VALUE_HIGH : GPIO_VALUE_LOW, 0 );
+	}
+	std::atomic_thread_fence( std::memory_order_release );
+	shm->version = GPIO_BROKER_VERSION;
+	shm->magic = GPIO_BROKER_MAGIC;
+
+	r = sockaddr_for( socket_path, & addr );
+	if ( -1 == r ) {
+		throw std::system_error( errno, std::system_category() );
+	}
+	unlink( socket_path.c_str() );
+	r = socket( AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0 );
+	if ( -1 == r ) {
+		throw std::system_error( errno, std::system_category() );
+	}
+	listen_fd = r;
+	r = bind( listen_fd, (struct sockaddr *) & addr, sizeof( addr ) );
+	if ( -1 == r ) {
+		throw std::system_error( errno, std::system_category() );
+	}
+	r = listen( listen_fd, SOMAXCONN );
+	if ( -1 == r ) {
+		throw std::system_error( errno, std::system_category() );
+	}
+}
+
+void GpioBroker::run() {
+
+	enum {
+		INTERRUPTEE,
+		LISTEN,
+		FIXED,
+	};
+
+	int r;
+	char buf[ 16 ];
+	std::vector<struct pollfd> pollfd;
+	std::vector<int> fds;
+	struct ucred cred;
+	socklen_t cred_len;
+
+	start();
+
+	for( ;; ) {
+
+		pollfd.resize( FIXED + clients.size() + pins.size() );
+		pollfd[ INTERRUPTEE ].fd = interruptee_fd;
+		pollfd[ INTERRUPTEE ].events = POLLIN;
+		pollfd[ LISTEN ].fd = listen_fd;
+		pollfd[ LISTEN ].events = POLLIN;
+		fds.clear();
+		for( auto & client: clients ) {
+			pollfd[ FIXED + fds.size() ].fd = client.first;
+			pollfd[ FIXED + fds.size() ].events = POLLIN;
+			fds.push_back( client.first );
+		}
+		for( size_t i = 0; i < pins.size(); i++ ) {
+			pollfd[ FIXED + fds.size() + i ].fd = GPIO_DIR_IN == pins[ i ].direction ? pins[ i ].value_fd : -1;
+			pollfd[ FIXED + fds.size() + i ].events = POLLPRI;
+		}
+
+		r = poll( pollfd.data(), pollfd.size(), -1 );
+		if ( -1 == r ) {
+			if ( EINTR == errno ) {
+				continue;
+			}
+			throw std::system_error( errno, std::system_category() );
+		}
+
+		if ( pollfd[ INTERRUPTEE ].revents & POLLIN ) {
+			while( read( interruptee_fd, buf, sizeof( buf ) ) > 0 ) {
+				// drain every pending wakeup
+			}
+			break;
+		}
+
+		for( size_t i = 0; i < pins.size(); i++ ) {
+			if ( pollfd[ FIXED + fds.size() + i ].revents & ( POLLPRI | POLLERR ) ) {
+				r = pread( pins[ i ].value_fd, buf, sizeof( buf ), 0 );
+				if ( r > 0 ) {
+					publish( i, '1' == buf[ 0 ] ? GPIO_VALUE_HIGH : GPIO_VALUE_LOW, shm->pin[ i ].owner.load( std::memory_order_relaxed ), true );
+				}
+			}
+		}
+
+		for( size_t i = 0; i < fds.size(); i++ ) {
+			if ( pollfd[ FIXED + i ].revents ) {
+				handle( fds[ i ] );
+			}
+		}
+
+		if ( pollfd[ LISTEN ].revents & POLLIN ) {
+			r = accept4( listen_fd, NULL, NULL, SOCK_CLOEXEC );
+			if ( -1 != r ) {
+				cred_len = sizeof( cred );
+				memset( & cred, 0, sizeof( cred ) );
+				getsockopt( r, SOL_SOCKET, SO_PEERCRED, & cred, & cred_len );
+				clients[ r ] = cred.pid;
+			}
+		}
+	}
+}
+
+void GpioBroker::interrupt() {
+	const char *foo = "!";
+	if ( -1 != interruptor_fd ) {
+		write( interruptor_fd, foo, strlen( foo ) );
+	}
+}
+
+void GpioBroker::publish( size_t idx, gpio_value_t value, int32_t owner, bool notified ) {
+	GpioBrokerPin & pin = shm->pin[ idx ];
+	uint32_t seq;
+	bool changed;
+
+	seq = pin.seq.load( std::memory_order_relaxed );
+	// a pulse shorter than our wakeup reads back unchanged, but is still an edge
+	changed = notified || value != pin.value.load( std::memory_order_relaxed );
+
+	pin.seq.store( seq + 1, std::memory_order_relaxed );
+	std::atomic_thread_fence( std::memory_order_release );
+
+	pin.value.store( value, std::memory_order_relaxed );
+	pin.owner.store( owner, std::memory_order_relaxed );
+	if ( changed || 0 == seq ) {
+		pin.timestamp_ns.store( now_ns(), std::memory_order_relaxed );
+	}
+
+	pin.seq.store( seq + 2, std::memory_order_release );
+
+	if ( changed ) {
+		pin.edges.fetch_add( 1, std::memory_order_release );
+		futex( & pin.edges, FUTEX_WAKE, INT_MAX, NULL );
+	}
+}
+
+void GpioBroker::handle( int fd ) {
+	int r;
+	gpio_broker_msg_t msg;
+	std::map<uint16_t,size_t>::iterator it;
+	Pin *pin;
+
+	r = recv( fd, & msg, sizeof( msg ), MSG_DONTWAIT );
+	if ( -1 == r && ( EAGAIN == errno || EINTR == errno ) ) {
+		return;
+	}
+	if ( r <= 0 ) {
+		disconnect( fd );
+		return;
+	}
+
+	if ( sizeof( msg ) != (size_t) r ) {
+		// msg is only partially filled in, so nothing in it can be trusted
+		memset( & msg, 0, sizeof( msg ) );
+		msg.err = EINVAL;
+		goto reply;
+	}
+	it = index.find( msg.num );
+	if ( index.end() == it ) {
+		msg.err = ENOENT;
+		goto reply;
+	}
+	pin = & pins[ it->second ];
+	if ( GPIO_DIR_OUT != pin->direction ) {
+		msg.err = EINVAL;
+		goto reply;
+	}
+
+	msg.err = EXIT_SUCCESS;
+	switch( msg.op ) {
+
+	case GPIO_BROKER_OP_CLAIM:
+	case GPIO_BROKER_OP_SET:
+		if ( -1 != pin->owner_fd && fd != pin->owner_fd ) {
+			msg.err = EBUSY;
+			break;
+		}
+		pin->owner_fd = fd;
+		if ( GPIO_BROKER_OP_SET == msg.op ) {
+			r = pwrite( pin->value_fd, msg.value ? "1" : "0", 1, 0 );
+			if ( -1 == r ) {
+				msg.err = errno;
+				break;
+			}
+		}
+		publish( it->second, GPIO_BROKER_OP_SET == msg.op ? ( msg.value ? GPIO_VALUE_HIGH : GPIO_VALUE_LOW ) : (gpio_value_t) shm->pin[ it->second ].value.load( std::memory_order_relaxed ), clients[ fd ] );
+		break;
+
+	case GPIO_BROKER_OP_RELEASE:
+		if ( fd != pin->owner_fd ) {
+			msg.err = EPERM;
+			break;
+		}
+		pin->owner_fd = -1;
+		publish( it->second, (gpio_value_t) shm->pin[ it->second ].value.load( std::memory_order_relaxed ), 0 );
+		break;
+
+	default:
+		msg.err = EINVAL;
+		break;
+	}
+
+reply:
+	send( fd, & msg, sizeof( msg ), MSG_NOSIGNAL );
+}
+
+void GpioBroker::disconnect( int fd ) {
+	for( size_t i = 0; i < pins.size(); i++ ) {
+		if ( fd == pins[ i ].owner_fd ) {
+			pins[ i ].owner_fd = -1;
+			publish( i, (gpio_value_t) shm->pin[ i ].value.load( std::memory_order_relaxed ), 0 );
+		}
+	}
+	clients.erase( fd );
+	close( fd );
+}
+
+void GpioBroker::stop() {
+	gpio_edge_t edge;
+
+	for( auto & client: clients ) {
+		close( client.first );
+	}
+	clients.clear();
+
+	if ( -1 != listen_fd ) {
+		close( listen_fd );
+		listen_fd = -1;
+		unlink( socket_path.c_str() );
+	}
+
+	if ( NULL != shm ) {
+		munmap( shm, shm_size );
+		shm = NULL;
+		shm_unlink( shm_name.c_str() );
+	}
+
+	for( auto & pin: pins ) {
+		if ( -1 != pin.value_fd ) {
+			close( pin.value_fd );
+			pin.value_fd = -1;
+		}
+		if ( pin.exported_by_us && gpio_is_exported( pin.num ) ) {
+			if ( GPIO_DIR_IN == pin.direction ) {
+				edge = GPIO_EDGE_NONE;
+				gpio_edge_set( pin.num, & edge );
+			}
+			gpio_unexport( pin.num );
+			pin.exported_by_us = false;
+		}
+	}
+}
+
+GpioBrokerClient::GpioBrokerClient( const std::string &shm_name, const std::string &socket_path )
+:
+	shm( NULL ),
+	shm_size( 0 ),
+	fd( -1 )
+{
+	int r;
+	struct stat st;
+	struct sockaddr_un addr;
+
+	r = sockaddr_for( socket_path, & addr );
+	if ( -1 == r ) {
+		throw std::system_error( errno, std::system_category() );
+	}
+	r = socket( AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0 );
+	if ( -1 == r ) {
+		throw std::system_error( errno, std::system_category() );
+	}
+	fd = r;
+	r = connect( fd, (struct sockaddr *) & addr, sizeof( addr ) );
+	if ( -1 == r ) {
+		r = errno;
+		close( fd );
+		throw std::system_error( r, std::system_category() );
+	}
+
+	r = shm_open( shm_name.c_str(), O_RDONLY | O_CLOEXEC, 0 );
+	if ( -1 == r ) {
+		r = errno;
+		close( fd );
+		throw std::system_error( r, std::system_category() );
+	}
+	shm = (const GpioBrokerShm *) MAP_FAILED;
+	if ( EXIT_SUCCESS == fstat( r, & st ) ) {
+		shm_size = st.st_size;
+		shm = (const GpioBrokerShm *) mmap( NULL, shm_size, PROT_READ, MAP_SHARED, r, 0 );
+	}
+	close( r );
+	if ( MAP_FAILED == shm ) {
+		r = errno;
+		shm = NULL;
+		close( fd );
+		throw std::system_error( r, std::system_category() );
+	}
+
+	if ( shm_size < sizeof( GpioBrokerShm )
+		|| GPIO_BROKER_MAGIC != shm->magic
+		|| GPIO_BROKER_VERSION != shm->version
+		|| shm_size < shm_size_for( shm->npins ) )
+	{
+		munmap( const_cast<GpioBrokerShm *>( shm ), shm_size );
+		close( fd );
+		throw std::system_error( EPROTO, std::system_category() );
+	}
+	std::atomic_thread_fence( std::memory_order_acquire );
+
+	for( size_t i = 0; i < shm->npins; i++ ) {
+		index[ shm->pin[ i ].num.load( std::memory_order_relaxed ) ] = i;
+	}
+}
+
+GpioBrokerClient::~GpioBrokerClient() {
+	if ( -1 != fd ) {
+		close( fd );
+		fd = -1;
+	}
+	if ( NULL != shm ) {
+		munmap( const_cast<GpioBrokerShm *>( shm ), shm_size );
+		shm = NULL;
+	}
+}
+
+std::vector<uint16_t> GpioBrokerClient::nums() {
+	std::vector<uint16_t> r;
+	for( auto & i: index ) {
+		r.push_back( i.first );
+	}
+	return r;
+}
+
+const GpioBrokerPin &GpioBrokerClient::pin( uint16_t num ) {
+	std::map<uint16_t,size_t>::iterator it;
+
+	it = index.find( num );
+	if ( index.end() == it ) {
+		throw std::system_error( ENOENT, std::system_category() );
+	}
+
+	return shm->pin[ it->second ];
+}
+
+GpioBrokerState GpioBrokerClient::state( uint16_t num ) {
+	const GpioBrokerPin & p = pin( num );
+	GpioBrokerState r;
+	uint32_t seq;
+
+	for( ;; ) {
+		seq = p.seq.load( std::memory_order_acquire );
+		if ( seq & 1 ) {
+			continue;
+		}
+		r.num = p.num.load( std::memory_order_relaxed );
+		r.direction = (gpio_direction_t) p.direction.load( std::memory_order_relaxed );
+		r.value = (gpio_value_t) p.value.load( std::memory_order_relaxed );
+		r.owner = p.owner.load( std::memory_order_relaxed );
+		r.timestamp_ns = p.timestamp_ns.load( std::memory_order_relaxed );
+		r.edges = p.edges.load( std::memory_order_relaxed );
+		std::atomic_thread_fence( std::memory_order_acquire );
+		if ( seq == p.seq.load( std::memory_order_relaxed ) ) {
+			break;
+		}
+	}
+
+	return r;
+}
+
+gpio_value_t GpioBrokerClient::value( uint16_t num ) {
+	return (gpio_value_t) pin( num ).value.load( std::memory_order_acquire );
+}
+
+uint32_t GpioBrokerClient::edges( uint16_t num ) {
+	return pin( num ).edges.load( std::memory_order_acquire );
+}
+
+uint32_t GpioBrokerClient::wait( uint16_t num, uint32_t seen, int timeout_ms ) {
+	const GpioBrokerPin & p = pin( num );
+	uint32_t r;
+	uint64_t deadline;
+	uint64_t now;
+	struct timespec ts;
+
+	deadline = now_ns() + (uint64_t) std::max( timeout_ms, 0 ) * 1000000;
+
+	for( ;; ) {
+		r = p.edges.load( std::memory_order_acquire );
+		if ( r != seen ) {
+			break;
+		}
+		if ( timeout_ms >= 0 ) {
+			now = now_ns();
+			if ( now >= deadline ) {
+				throw std::system_error( ETIMEDOUT, std::system_category() );
+			}
+			ts.tv_sec = ( deadline - now ) / 1000000000;
+			ts.tv_nsec = ( deadline - now ) % 1000000000;
+		}
+		if ( -1 == futex( & p.edges, FUTEX_WAIT, seen, timeout_ms >= 0 ? & ts : NULL ) ) {
+			if ( EAGAIN == errno || EINTR == errno || ETIMEDOUT == errno ) {
+				continue;
+			}
+			throw std::system_error( errno, std::system_category() );
+		}
+	}
+
+	return r;
+}
+
+void GpioBrokerClient::request( unsigned op, uint16_t num, unsigned value ) {
+	int r;
+	gpio_broker_msg_t msg;
+
+	memset( & msg, 0, sizeof( msg ) );
+	msg.op = op;
+	msg.num = num;
+	msg.value = value;
+
+	r = send( fd, & msg, sizeof( msg ), MSG_NOSIGNAL );
+	if ( -1 == r ) {
+		throw std::system_error( errno, std::system_category() );
+	}
+	do {
+		r = recv( fd, & msg, sizeof( msg ), 0 );
+	} while( -1 == r && EINTR == errno );
+	if ( -1 == r ) {
+		throw std::system_error( errno, std::system_category() );
+	}
+	if ( 0 == r ) {
+		throw std::system_error( ECONNRESET, std::system_category() );
+	}
+	if ( EXIT_SUCCESS != msg.err ) {
+		throw std::system_error( msg.err, std::system_category() );
+	}
+}
+
+void GpioBrokerClient::claim( uint16_t num ) {
+	request( GPIO_BROKER_OP_CLAIM, num, 0 );
+}
+
+void GpioBrokerClient::release( uint16_t num ) {
+	request( GPIO_BROKER_OP_RELEASE, num, 0 );
+}
+
+void GpioBrokerClient::value( uint16_t num, gpio_value_t value ) {
+	request( GPIO_BROKER_OP_SET, num, value );
+}
@@ -0,0 +1,576 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include <limits.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "libgpio/GpioDispatcher.h"
+
+using namespace ::std;
+using namespace ::com::github::cfriedt;
+
+namespace {
+
+// set when a dispatcher is destroyed from one of its own callbacks, so that
+// the thread that invoked the callback leaves without touching it again
+thread_local const GpioDispatcher *destroyed;
+
+bool released( const GpioDispatcher *dispatcher ) {
+	if ( dispatcher != destroyed ) {
+		return false;
+	}
+	destroyed = NULL;
+	return true;
+}
+
+}
+
+GpioEventQueue::GpioEventQueue( size_t capacity )
+:
+	capacity( capacity ),
+	ndropped( 0 )
+{
+}
+
+GpioEventQueue::~GpioEventQueue() {
+}
+
+void GpioEventQueue::push( const GpioEvent &event ) {
+	{
+		std::lock_guard<std::mutex> guard( lock );
+		if ( events.size() >= capacity ) {
+			events.pop_front();
+			ndropped++;
+		}
+		events.push_back( event );
+	}
+	cv.notify_one();
+}
+
+bool GpioEventQueue::pop( GpioEvent &event, int timeout_ms ) {
+	std::unique_lock<std::mutex> guard( lock );
+
+	if ( timeout_ms < 0 ) {
+		cv.wait( guard, [ this ]() { return ! events.empty(); } );
+	} else if ( ! cv.wait_for( guard, std::chrono::milliseconds( timeout_ms ), [ this ]() { return ! events.empty(); } ) ) {
+		return false;
+	}
+
+	event = events.front();
+	events.pop_front();
+
+	return true;
+}
+
+size_t GpioEventQueue::size() {
+	std::lock_guard<std::mutex> guard( lock );
+	return events.size();
+}
+
+size_t GpioEventQueue::dropped() {
+	std::lock_guard<std::mutex> guard( lock );
+	return ndropped;
+}
+
+GpioDispatcher::GpioDispatcher()
+:
+	next_id( 0 ),
+	stopping( false ),
+	interruptee_fd( -1 ),
+	interruptor_fd( -1 )
+{
+	int r;
+	int sv[ 2 ];
+
+	r = socketpair( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0, sv );
+	if ( -1 == r ) {
+		throw std::system_error( errno, std::system_category() );
+	}
+	interruptee_fd = sv[ 0 ];
+	interruptor_fd = sv[ 1 ];
+}
+
+GpioDispatcher::~GpioDispatcher() {
+	bool calling;
+
+	{
+		std::lock_guard<std::mutex> guard( lock );
+		stopping = true;
+		calling = std::this_thread::get_id() == thread.get_id();
+		for( auto & i: inflight ) {
+			calling = calling || std::this_thread::get_id() == i.second;
+		}
+	}
+	wake();
+	if ( calling ) {
+		destroyed = this;
+	}
+	if ( thread.joinable() ) {
+		if ( std::this_thread::get_id() == thread.get_id() ) {
+			// destroyed from a callback; a thread cannot join itself
+			thread.detach();
+		} else {
+			thread.join();
+		}
+	}
+	for( auto & source: sources ) {
+		close( source.second.fd );
+	}
+	sources.clear();
+	close( interruptee_fd );
+	close( interruptor_fd );
+}
+
+GpioDispatcher::Subscription GpioDispatcher::subscribe( uint16_t num, gpio_edge_t edge, Callback callback ) {
+	Subscriber subscriber = {};
+	std::map<uint16_t,Source>::iterator it;
+	Source source;
+
+	if ( GPIO_EDGE_RISING != edge && GPIO_EDGE_FALLING != edge && GPIO_EDGE_BOTH != edge ) {
+		throw std::system_error( EINVAL, std::system_category() );
+	}
+
+	subscriber.edge = edge;
+	subscriber.callback = std::make_shared<Callback>( callback );
+
+	{
+		std::lock_guard<std::mutex> guard( lock );
+		if ( sources.end() != sources.find( num ) ) {
+			return add( num, subscriber );
+		}
+		opening[ num ]++;
+	}
+
+	// exporting may take up to the export timeout, so it is done unlocked
+	try {
+		prepare( num, source );
+	} catch( ... ) {
+		std::lock_guard<std::mutex> guard( lock );
+		if ( 0 == --opening[ num ] ) {
+			opening.erase( num );
+		}
+		if ( source.gpio && ( sources.count( num ) > 0 || opening.count( num ) > 0 ) ) {
+			source.gpio->ownership( Gpio::LEAVE_EXPORTED );
+		}
+		throw;
+	}
+
+	std::lock_guard<std::mutex> guard( lock );
+
+	if ( 0 == --opening[ num ] ) {
+		opening.erase( num );
+	}
+
+	it = sources.find( num );
+	if ( sources.end() == it ) {
+		source.guard.config( storm_config );
+		sources.insert( std::make_pair( num, std::move( source ) ) );
+	} else {
+		// another thread got there first; the GPIO is in use, so leave it exported
+		source.gpio->ownership( Gpio::LEAVE_EXPORTED );
+		close( source.fd );
+	}
+
+	return add( num, subscriber );
+}
+
+void GpioDispatcher::prepare( uint16_t num, Source &source ) {
+	int r;
+	char buf[ PATH_MAX ];
+
+	source.gpio.reset( new Gpio( num, GPIO_EDGE_BOTH ) );
+
+	memset( buf, 0, sizeof( buf ) );
+	snprintf( buf, sizeof( buf ) - 1, "%s/gpio%u/value", gpio_sysfs_root_get(), num );
+	r = open( buf, O_RDONLY | O_CLOEXEC );
+	if ( -1 == r ) {
+		throw std::system_error( errno, std::system_category() );
+	}
+	source.fd = r;
+
+	// reading also clears the initial POLLPRI
+	r = pread( source.fd, buf, sizeof( buf ), 0 );
+	if ( -1 == r ) {
+		r = errno;
+		close( source.fd );
+		throw std::system_error( r, std::system_category() );
+	}
+	source.value = r > 0 && '1' == buf[ 0 ] ? GPIO_VALUE_HIGH : GPIO_VALUE_LOW;
+}
+
+GpioDispatcher::Subscription GpioDispatcher::add( uint16_t num, Subscriber subscriber ) {
+	subscriber.id = next_id++;
+	sources[ num ].subscribers.push_back( subscriber );
+	live.insert( subscriber.id );
+
+	if ( ! thread.joinable() ) {
+		thread = std::thread( & GpioDispatcher::run, this );
+	} else {
+		wake();
+	}
+
+	return subscriber.id;
+}
+
+GpioDispatcher::Subscription GpioDispatcher::subscribe( uint16_t num, gpio_edge_t edge, GpioEventQueue &queue ) {
+	GpioEventQueue *q = & queue;
+	return subscribe( num, edge, [ q ]( const GpioEvent &event ) {
+		q->push( event );
+	} );
+}
+
+void GpioDispatcher::unsubscribe( Subscription subscription ) {
+	std::unique_lock<std::mutex> guard( lock );
+
+	if ( 0 == live.erase( subscription ) ) {
+		return;
+	}
+
+	for( auto it = sources.begin(); it != sources.end(); ++it ) {
+		std::vector<Subscriber> & subscribers = it->second.subscribers;
+		auto jt = std::find_if( subscribers.begin(), subscribers.end(), [ subscription ]( const Subscriber &s ) {
+			return subscription == s.id;
+		} );
+		if ( subscribers.end() == jt ) {
+			continue;
+		}
+		subscribers.erase( jt );
+		if ( subscribers.empty() ) {
+			if ( opening.count( it->first ) > 0 ) {
+				// a subscribe() is setting the GPIO up again, unlocked
+				it->second.gpio->ownership( Gpio::LEAVE_EXPORTED );
+			}
+			// the dispatcher thread only trusts fds it finds in sources
+			close( it->second.fd );
+			sources.erase( it );
+			wake();
+		}
+		break;
+	}
+
+	// a delivery on this thread is further up the stack, waiting for us
+	delivered.wait( guard, [ this, subscription ]() {
+		for( auto & i: inflight ) {
+			if ( subscription == i.first && std::this_thread::get_id() != i.second ) {
+				return false;
+			}
+		}
+		return true;
+	} );
+}
+
+void GpioDispatcher::storm( const GpioStormGuard::Config &config ) {
+	std::lock_guard<std::mutex> guard( lock );
+
+	storm_config = config;
+	for( auto & source: sources ) {
+		source.second.guard.config( config );
+	}
+}
+
+void GpioDispatcher::storm( uint16_t num, const GpioStormGuard::Config &config ) {
+	std::lock_guard<std::mutex> guard( lock );
+	std::map<uint16_t,Source>::iterator it;
+
+	it = sources.find( num );
+	if ( sources.end() == it ) {
+		throw std::system_error( ENOENT, std::system_category() );
+	}
+	it->second.guard.config( config );
+}
+
+GpioStormGuard::Counters GpioDispatcher::storm_counters( uint16_t num ) {
+	std::lock_guard<std::mutex> guard( lock );
+	std::map<uint16_t,Source>::iterator it;
+
+	it = sources.find( num );
+	if ( sources.end() == it ) {
+		throw std::system_error( ENOENT, std::system_category() );
+	}
+	return it->second.guard.counters();
+}
+
+void GpioDispatcher::on_storm( StormCallback callback ) {
+	std::lock_guard<std::mutex> guard( lock );
+	storm_callback = std::make_shared<StormCallback>( callback );
+}
+
+void GpioDispatcher::wake() {
+	const char *foo = "!";
+	write( interruptor_fd, foo, strlen( foo ) );
+}
+
+void GpioDispatcher::run() {
+	int r;
+	char buf[ 16 ];
+	std::vector<struct pollfd> pollfd;
+	std::vector<uint16_t> nums;
+	std::vector<std::pair<uint16_t,gpio_value_t>> reads;
+	std::chrono::steady_clock::time_point now;
+	std::chrono::steady_clock::time_point holdoff;
+	int timeout;
+	std::map<uint16_t,Source>::iterator it;
+
+	for( ;; ) {
+
+		{
+			std::lock_guard<std::mutex> guard( lock );
+			if ( stopping ) {
+				break;
+			}
+			pollfd.resize( 1 + sources.size() );
+			nums.clear();
+			holdoff = std::chrono::steady_clock::time_point::max();
+			for( auto & source: sources ) {
+				pollfd[ 1 + nums.size() ].fd = source.second.fd;
+				pollfd[ 1 + nums.size() ].events = POLLPRI;
+				if ( source.second.guard.storming() ) {
+					holdoff = std::min( holdoff, source.second.guard.holdoff() );
+					if ( ! source.second.guard.config().exact ) {
+						// poll() ignores negative fds; flush() samples the GPIO instead
+						pollfd[ 1 + nums.size() ].fd = -1;
+					}
+				}
+				nums.push_back( source.first );
+			}
+		}
+		pollfd[ 0 ].fd = interruptee_fd;
+		pollfd[ 0 ].events = POLLIN;
+
+		timeout = -1;
+		if ( std::chrono::steady_clock::time_point::max() != holdoff ) {
+			now = std::chrono::steady_clock::now();
+			timeout = holdoff <= now ? 0 : std::chrono::duration_cast<std::chrono::milliseconds>( holdoff - now ).count() + 1;
+		}
+
+		r = poll( pollfd.data(), pollfd.size(), timeout );
+		if ( -1 == r ) {
+			if ( EINTR == errno ) {
+				continue;
+			}
+			// nowhere to report it from this thread
+			break;
+		}
+		now = std::chrono::steady_clock::now();
+
+		if ( pollfd[ 0 ].revents & POLLIN ) {
+			while( read( interruptee_fd, buf, sizeof( buf ) ) > 0 ) {
+				// drain every pending wakeup
+			}
+		}
+
+		reads.clear();
+		{
+			std::lock_guard<std::mutex> guard( lock );
+			for( size_t i = 0; i < nums.size(); i++ ) {
+				if ( ! ( pollfd[ 1 + i ].revents & ( POLLPRI | POLLERR ) ) ) {
+					continue;
+				}
+				it = sources.find( nums[ i ] );
+				if ( sources.end() == it || pollfd[ 1 + i ].fd != it->second.fd ) {
+					continue;
+				}
+				r = pread( it->second.fd, buf, sizeof( buf ), 0 );
+				if ( r > 0 ) {
+					reads.push_back( std::make_pair( nums[ i ], '1' == buf[ 0 ] ? GPIO_VALUE_HIGH : GPIO_VALUE_LOW ) );
+				}
+			}
+		}
+
+		for( auto & rd: reads ) {
+			if ( ! deliver( rd.first, rd.second, now ) ) {
+				return;
+			}
+		}
+
+		if ( ! flush( std::chrono::steady_clock::now() ) ) {
+			return;
+		}
+	}
+}
+
+bool GpioDispatcher::invoke( const Subscriber &subscriber, const GpioEvent &event ) {
+	{
+		std::lock_guard<std::mutex> guard( lock );
+		if ( 0 == live.count( subscriber.id ) ) {
+			return true;
+		}
+		inflight.push_back( std::make_pair( subscriber.id, std::this_thread::get_id() ) );
+	}
+
+	( *subscriber.callback )( event );
+	if ( released( this ) ) {
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard( lock );
+		inflight.erase( std::find( inflight.begin(), inflight.end(), std::make_pair( subscriber.id, std::this_thread::get_id() ) ) );
+	}
+	delivered.notify_all();
+
+	return true;
+}
+
+bool GpioDispatcher::flush( std::chrono::steady_clock::time_point now ) {
+	unsigned n;
+	int r;
+	char buf[ 16 ];
+	struct pollfd pollfd;
+	GpioEvent event;
+	std::vector<std::pair<Subscriber,GpioEvent>> callbacks;
+	std::vector<std::pair<uint16_t,GpioStormGuard::Counters>> ended;
+	std::shared_ptr<StormCallback> storm_cb;
+
+	{
+		std::lock_guard<std::mutex> guard( lock );
+
+		for( auto & source: sources ) {
+			if ( ! source.second.guard.storming() || source.second.guard.holdoff() > now ) {
+				continue;
+			}
+
+			if ( ! source.second.guard.config().exact ) {
+				// the GPIO was not watched during the interval; at least one
+				// notification is pending if anything happened
+				pollfd.fd = source.second.fd;
+				pollfd.events = POLLPRI;
+				pollfd.revents = 0;
+				if ( 1 == poll( & pollfd, 1, 0 ) && ( pollfd.revents & ( POLLPRI | POLLERR ) ) ) {
+					source.second.guard.edge( now );
+					r = pread( source.second.fd, buf, sizeof( buf ), 0 );
+					if ( r > 0 ) {
+						source.second.value = '1' == buf[ 0 ] ? GPIO_VALUE_HIGH : GPIO_VALUE_LOW;
+					}
+				}
+			}
+
+			n = source.second.guard.flush( now );
+
+			if ( n > 0 ) {
+				event.num = source.first;
+				event.value = source.second.value;
+				event.edge = GPIO_EDGE_BOTH;
+				event.timestamp = now;
+				event.count = n;
+				for( auto & subscriber: source.second.subscribers ) {
+					callbacks.push_back( std::make_pair( subscriber, event ) );
+				}
+			}
+
+			if ( ! source.second.guard.storming() ) {
+				ended.push_back( std::make_pair( source.first, source.second.guard.counters() ) );
+			}
+		}
+
+		storm_cb = storm_callback;
+	}
+
+	for( auto & callback: callbacks ) {
+		if ( ! invoke( callback.first, callback.second ) ) {
+			return false;
+		}
+	}
+	if ( storm_cb ) {
+		for( auto & e: ended ) {
+			( *storm_cb )( e.first, false, e.second );
+			if ( released( this ) ) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool GpioDispatcher::deliver( uint16_t num, gpio_value_t value, std::chrono::steady_clock::time_point timestamp ) {
+	GpioEvent event;
+	std::vector<Subscriber> callbacks;
+	std::map<uint16_t,Source>::iterator it;
+	std::shared_ptr<StormCallback> storm_cb;
+	GpioStormGuard::Counters counters;
+	bool started;
+
+	{
+		std::lock_guard<std::mutex> guard( lock );
+
+		it = sources.find( num );
+		if ( sources.end() == it ) {
+			return true;
+		}
+
+		started = ! it->second.guard.storming();
+		if ( ! it->second.guard.edge( timestamp ) ) {
+			// held back for the aggregated event
+			it->second.value = value;
+			return true;
+		}
+		started = started && it->second.guard.storming();
+		if ( started ) {
+			// the dispatcher thread needs a timeout for the coalescing interval
+			storm_cb = storm_callback;
+			counters = it->second.guard.counters();
+			wake();
+		}
+
+		if ( value != it->second.value ) {
+			it->second.value = value;
+
+			event.num = num;
+			event.value = value;
+			event.edge = GPIO_VALUE_HIGH == value ? GPIO_EDGE_RISING : GPIO_EDGE_FALLING;
+			event.timestamp = timestamp;
+			event.count = 1;
+
+			for( auto & subscriber: it->second.subscribers ) {
+				if ( GPIO_EDGE_BOTH == subscriber.edge || event.edge == subscriber.edge ) {
+					callbacks.push_back( subscriber );
+				}
+			}
+		}
+	}
+
+	if ( started && storm_cb ) {
+		( *storm_cb )( num, true, counters );
+		if ( released( this ) ) {
+			return false;
+		}
+	}
+	for( auto & callback: callbacks ) {
+		if ( ! invoke( callback, event ) ) {
+			return false;
+		}
+	}
+
+	return true;
+}
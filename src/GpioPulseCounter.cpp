@@ -0,0 +1,150 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "libgpio/GpioPulseCounter.h"
+
+using namespace ::std;
+using namespace ::com::github::cfriedt;
+
+GpioPulseCounter::GpioPulseCounter( GpioDispatcher &dispatcher, uint16_t num, std::chrono::nanoseconds window )
+:
+	GpioPulseCounter( window )
+{
+	subscription = dispatcher.subscribe( num, GPIO_EDGE_BOTH, [ this ]( const GpioEvent &event ) {
+		edge( event );
+	} );
+	this->dispatcher = & dispatcher;
+}
+
+GpioPulseCounter::GpioPulseCounter( std::chrono::nanoseconds window )
+:
+	dispatcher( NULL ),
+	subscription( 0 ),
+	win( window )
+{
+	reset();
+}
+
+GpioPulseCounter::~GpioPulseCounter() {
+	if ( NULL != dispatcher ) {
+		dispatcher->unsubscribe( subscription );
+	}
+}
+
+void GpioPulseCounter::window( std::chrono::nanoseconds window ) {
+	std::lock_guard<std::mutex> guard( lock );
+	win = window;
+}
+
+void GpioPulseCounter::edge( const GpioEvent &event ) {
+	Cycle cycle;
+
+	std::lock_guard<std::mutex> guard( lock );
+
+	if ( GPIO_EDGE_RISING == event.edge ) {
+
+		nrising++;
+
+		if ( have_fall && ( ! have_rise || last_fall > last_rise ) ) {
+			last_low = event.timestamp - last_fall;
+		}
+		if ( have_rise && have_fall && last_fall > last_rise ) {
+			cycle.start = last_rise;
+			cycle.high = last_fall - last_rise;
+			cycle.period = event.timestamp - last_rise;
+			cycles.push_back( cycle );
+			sum_high += cycle.high;
+			sum_period += cycle.period;
+		}
+		have_rise = true;
+		last_rise = event.timestamp;
+
+	} else if ( GPIO_EDGE_FALLING == event.edge ) {
+
+		nfalling++;
+
+		if ( have_rise && ( ! have_fall || last_rise > last_fall ) ) {
+			last_high = event.timestamp - last_rise;
+		}
+		have_fall = true;
+		last_fall = event.timestamp;
+
+	} else {
+
+		// coalesced, so the partial cycle can no longer be timed
+		nuntimed += event.count;
+		have_rise = false;
+		have_fall = false;
+	}
+
+	trim( event.timestamp );
+}
+
+GpioPulseStats GpioPulseCounter::stats( time_point now ) {
+	GpioPulseStats r;
+
+	std::lock_guard<std::mutex> guard( lock );
+
+	trim( now );
+
+	r.rising = nrising;
+	r.falling = nfalling;
+	r.untimed = nuntimed;
+	r.cycles = cycles.size();
+	r.frequency = 0;
+	r.period = std::chrono::nanoseconds::zero();
+	r.duty_cycle = 0;
+	if ( r.cycles > 0 && sum_period.count() > 0 ) {
+		r.frequency = r.cycles * 1e9 / sum_period.count();
+		r.period = sum_period / r.cycles;
+		r.duty_cycle = (double) sum_high.count() / sum_period.count();
+	}
+	r.high = last_high;
+	r.low = last_low;
+
+	return r;
+}
+
+void GpioPulseCounter::reset() {
+	std::lock_guard<std::mutex> guard( lock );
+
+	nrising = 0;
+	nfalling = 0;
+	nuntimed = 0;
+	have_rise = false;
+	have_fall = false;
+	last_high = std::chrono::nanoseconds::zero();
+	last_low = std::chrono::nanoseconds::zero();
+	cycles.clear();
+	sum_high = std::chrono::nanoseconds::zero();
+	sum_period = std::chrono::nanoseconds::zero();
+}
+
+void GpioPulseCounter::trim( time_point now ) {
+	while( ! cycles.empty() && cycles.front().start + win < now ) {
+		sum_high -= cycles.front().high;
+		sum_period -= cycles.front().period;
+		cycles.pop_front();
+	}
+}
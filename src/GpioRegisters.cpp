@@ -0,0 +1,246 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <errno.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include "libgpio/GpioRegisters.h"
+
+using namespace ::std;
+using namespace ::com::github::cfriedt;
+
+const uint32_t GpioRegisterLayout::NONE = 0xffffffff;
+
+const GpioRegisterLayout &GpioRegisterLayout::bcm2835() {
+	static const GpioRegisterLayout layout = {
+		"bcm2835",
+		0xb4,
+		54,
+		// GPSET0/1, GPCLR0/1 and GPLEV0/1
+		32,
+		4,
+		0x34,
+		NONE,
+		0x1c,
+		0x28,
+		// GPFSEL0-5: 3 bits per pin, 000 input, 001 output, others alternate functions
+		0x00,
+		3,
+		10,
+		0,
+		1,
+	};
+	return layout;
+}
+
+GpioRegisters::GpioRegisters( const GpioRegisterLayout &layout, const std::string &path, off_t offset )
+:
+	regs_layout( layout ),
+	base( NULL )
+{
+	int r;
+	int fd;
+	void *p;
+
+	if ( 0 == layout.bank_pins || layout.bank_pins > 32 || 0 == layout.dir_bits || 0 == layout.dir_pins || layout.dir_bits * layout.dir_pins > 32 ) {
+		throw std::system_error( EINVAL, std::system_category() );
+	}
+	if ( GpioRegisterLayout::NONE == layout.out && ( GpioRegisterLayout::NONE == layout.set || GpioRegisterLayout::NONE == layout.clear ) ) {
+		throw std::system_error( EINVAL, std::system_category() );
+	}
+
+	r = open( path.c_str(), O_RDWR | O_SYNC | O_CLOEXEC );
+	if ( -1 == r ) {
+		throw std::system_error( errno, std::system_category() );
+	}
+	fd = r;
+
+	p = mmap( NULL, layout.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset );
+	r = errno;
+	// the mapping stays valid without the descriptor
+	close( fd );
+	if ( MAP_FAILED == p ) {
+		throw std::system_error( r, std::system_category() );
+	}
+	base = (volatile uint8_t *) p;
+}
+
+GpioRegisters::~GpioRegisters() {
+	munmap( (void *) base, regs_layout.size );
+}
+
+const GpioRegisterLayout &GpioRegisters::layout() {
+	return regs_layout;
+}
+
+void GpioRegisters::set_mask( unsigned bank, uint32_t mask ) {
+	write_mask( bank, mask, 0 );
+}
+
+void GpioRegisters::clear_mask( unsigned bank, uint32_t mask ) {
+	write_mask( bank, 0, mask );
+}
+
+void GpioRegisters::write_mask( unsigned bank, uint32_t set, uint32_t clear ) {
+	uint32_t v;
+
+	if ( GpioRegisterLayout::NONE != regs_layout.set && GpioRegisterLayout::NONE != regs_layout.clear ) {
+		if ( 0 != set ) {
+			reg( regs_layout.set + bank * regs_layout.bank_stride ) = set;
+		}
+		if ( 0 != clear ) {
+			reg( regs_layout.clear + bank * regs_layout.bank_stride ) = clear;
+		}
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard( lock );
+	v = reg( regs_layout.out + bank * regs_layout.bank_stride );
+	v = ( v | set ) & ~clear;
+	reg( regs_layout.out + bank * regs_layout.bank_stride ) = v;
+}
+
+gpio_direction_t GpioRegisters::direction( unsigned pin ) {
+	uint32_t v;
+	uint32_t field;
+
+	v = reg( regs_layout.direction + pin / regs_layout.dir_pins * 4 );
+	field = v >> ( pin % regs_layout.dir_pins * regs_layout.dir_bits );
+	field &= ( (uint64_t) 1 << regs_layout.dir_bits ) - 1;
+
+	return regs_layout.dir_out == field ? GPIO_DIR_OUT : GPIO_DIR_IN;
+}
+
+void GpioRegisters::direction( unsigned pin, gpio_direction_t direction ) {
+	uint32_t v;
+	uint32_t mask;
+	unsigned shift;
+	volatile uint32_t *r;
+
+	r = & reg( regs_layout.direction + pin / regs_layout.dir_pins * 4 );
+	shift = pin % regs_layout.dir_pins * regs_layout.dir_bits;
+	mask = ( ( (uint64_t) 1 << regs_layout.dir_bits ) - 1 ) << shift;
+
+	std::lock_guard<std::mutex> guard( lock );
+	v = *r;
+	v &= ~mask;
+	v |= ( ( GPIO_DIR_OUT == direction ? regs_layout.dir_out : regs_layout.dir_in ) << shift ) & mask;
+	*r = v;
+}
+
+GpioRegisterPin::GpioRegisterPin( GpioRegisters &regs, unsigned pin, gpio_direction_t direction )
+:
+	regs( regs ),
+	pin( pin )
+{
+	if ( pin >= regs.layout().npins ) {
+		throw std::system_error( EINVAL, std::system_category() );
+	}
+	regs.direction( pin, direction );
+}
+
+GpioRegisterPin::~GpioRegisterPin() {
+}
+
+unsigned GpioRegisterPin::num() {
+	return pin;
+}
+
+gpio_direction_t GpioRegisterPin::direction() {
+	return regs.direction( pin );
+}
+
+void GpioRegisterPin::direction( gpio_direction_t direction ) {
+	regs.direction( pin, direction );
+}
+
+GpioRegisterPort::GpioRegisterPort( GpioRegisters &regs, const std::vector<unsigned> &pins, gpio_direction_t direction )
+:
+	regs( regs )
+{
+	unsigned bank;
+	size_t j;
+
+	if ( pins.empty() || pins.size() > 32 ) {
+		throw std::system_error( EINVAL, std::system_category() );
+	}
+	for( auto & pin: pins ) {
+		if ( pin >= regs.layout().npins ) {
+			throw std::system_error( EINVAL, std::system_category() );
+		}
+	}
+
+	for( size_t i = 0; i < pins.size(); i++ ) {
+		bank = pins[ i ] / regs.layout().bank_pins;
+		for( j = 0; j < banks.size() && bank != banks[ j ].bank; j++ );
+		if ( banks.size() == j ) {
+			banks.push_back( Bank() );
+			banks.back().bank = bank;
+		}
+		banks[ j ].bits.push_back( std::make_pair( (unsigned) i, pins[ i ] % regs.layout().bank_pins ) );
+	}
+
+	for( auto & pin: pins ) {
+		regs.direction( pin, direction );
+	}
+}
+
+GpioRegisterPort::~GpioRegisterPort() {
+}
+
+void GpioRegisterPort::write( uint32_t value ) {
+	uint32_t set;
+	uint32_t clear;
+
+	for( auto & bank: banks ) {
+		set = 0;
+		clear = 0;
+		for( auto & bit: bank.bits ) {
+			if ( ( value >> bit.first ) & 1 ) {
+				set |= (uint32_t) 1 << bit.second;
+			} else {
+				clear |= (uint32_t) 1 << bit.second;
+			}
+		}
+		regs.write_mask( bank.bank, set, clear );
+	}
+}
+
+uint32_t GpioRegisterPort::read() {
+	uint32_t r;
+	uint32_t levels;
+
+	r = 0;
+	for( auto & bank: banks ) {
+		levels = regs.levels( bank.bank );
+		for( auto & bit: bank.bits ) {
+			r |= ( ( levels >> bit.second ) & 1 ) << bit.first;
+		}
+	}
+
+	return r;
+}
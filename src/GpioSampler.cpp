@@ -0,0 +1,385 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "libgpio/GpioSampler.h"
+
+using namespace ::std;
+using namespace ::com::github::cfriedt;
+
+GpioSampler::GpioSampler( const std::vector<uint16_t> &nums, std::chrono::nanoseconds period, size_t samples, size_t chunks )
+:
+	gpio_nums( nums ),
+	sample_period( period ),
+	chunk_samples( samples ),
+	current( NULL ),
+	stats(),
+	timer_fd( -1 ),
+	interruptee_fd( -1 ),
+	interruptor_fd( -1 )
+{
+	int r;
+	int sv[ 2 ];
+
+	if ( nums.empty() || period <= std::chrono::nanoseconds::zero() || 0 == samples || 0 == chunks ) {
+		throw std::system_error( EINVAL, std::system_category() );
+	}
+
+	for( auto & num: nums ) {
+		gpios.push_back( std::unique_ptr<Gpio>( new Gpio( num ) ) );
+	}
+
+	for( auto & num: nums ) {
+		r = gpio_prop_open( num, GPIO_PROP_VALUE );
+		if ( -1 == r ) {
+			r = errno;
+			close_fds();
+			throw std::system_error( r, std::system_category() );
+		}
+		fds.push_back( r );
+	}
+
+	r = socketpair( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0, sv );
+	if ( -1 == r ) {
+		r = errno;
+		close_fds();
+		throw std::system_error( r, std::system_category() );
+	}
+	interruptee_fd = sv[ 0 ];
+	interruptor_fd = sv[ 1 ];
+
+	pool.resize( chunks );
+	for( auto & chunk: pool ) {
+		chunk.tick = 0;
+		chunk.count = 0;
+		chunk.stride = ( samples + 63 ) / 64;
+		chunk.bits.resize( nums.size() * chunk.stride );
+		free_chunks.push_back( & chunk );
+	}
+}
+
+GpioSampler::~GpioSampler() {
+	stop();
+	close_fds();
+}
+
+void GpioSampler::close_fds() {
+	for( auto & fd: fds ) {
+		close( fd );
+	}
+	fds.clear();
+	if ( -1 != interruptee_fd ) {
+		close( interruptee_fd );
+		interruptee_fd = -1;
+	}
+	if ( -1 != interruptor_fd ) {
+		close( interruptor_fd );
+		interruptor_fd = -1;
+	}
+}
+
+const std::vector<uint16_t> &GpioSampler::nums() {
+	return gpio_nums;
+}
+
+std::chrono::nanoseconds GpioSampler::period() {
+	return sample_period;
+}
+
+void GpioSampler::start() {
+	int r;
+	char buf[ 16 ];
+	struct itimerspec its;
+
+	if ( thread.joinable() ) {
+		throw std::system_error( EBUSY, std::system_category() );
+	}
+
+	r = timerfd_create( CLOCK_MONOTONIC, TFD_CLOEXEC );
+	if ( -1 == r ) {
+		throw std::system_error( errno, std::system_category() );
+	}
+	timer_fd = r;
+
+	while( read( interruptee_fd, buf, sizeof( buf ) ) > 0 ) {
+		// drain every pending wakeup
+	}
+
+	{
+		std::lock_guard<std::mutex> guard( lock );
+		memset( & stats, 0, sizeof( stats ) );
+	}
+
+	its.it_interval.tv_sec = sample_period.count() / 1000000000;
+	its.it_interval.tv_nsec = sample_period.count() % 1000000000;
+	its.it_value = its.it_interval;
+	r = timerfd_settime( timer_fd, 0, & its, NULL );
+	if ( -1 == r ) {
+		r = errno;
+		close( timer_fd );
+		timer_fd = -1;
+		throw std::system_error( r, std::system_category() );
+	}
+
+	thread = std::thread( & GpioSampler::run, this );
+}
+
+void GpioSampler::stop() {
+	const char *foo = "!";
+
+	if ( ! thread.joinable() ) {
+		return;
+	}
+
+	write( interruptor_fd, foo, strlen( foo ) );
+	thread.join();
+
+	close( timer_fd );
+	timer_fd = -1;
+
+	hand_off();
+}
+
+bool GpioSampler::pop( const GpioSampleChunk *&chunk, int timeout_ms ) {
+	std::unique_lock<std::mutex> guard( lock );
+
+	if ( timeout_ms < 0 ) {
+		cv.wait( guard, [ this ]() { return ! full_chunks.empty(); } );
+	} else if ( ! cv.wait_for( guard, std::chrono::milliseconds( timeout_ms ), [ this ]() { return ! full_chunks.empty(); } ) ) {
+		return false;
+	}
+
+	chunk = full_chunks.front();
+	full_chunks.pop_front();
+
+	return true;
+}
+
+void GpioSampler::release( const GpioSampleChunk *chunk ) {
+	std::lock_guard<std::mutex> guard( lock );
+	free_chunks.push_back( const_cast<GpioSampleChunk *>( chunk ) );
+}
+
+GpioSampler::Counters GpioSampler::counters() {
+	std::lock_guard<std::mutex> guard( lock );
+	return stats;
+}
+
+void GpioSampler::run() {
+	int r;
+	uint64_t expirations;
+	struct pollfd pollfd[ 2 ];
+
+	pollfd[ 0 ].fd = interruptee_fd;
+	pollfd[ 0 ].events = POLLIN;
+	pollfd[ 1 ].fd = timer_fd;
+	pollfd[ 1 ].events = POLLIN;
+
+	for( ;; ) {
+		r = poll( pollfd, 2, -1 );
+		if ( -1 == r ) {
+			if ( EINTR == errno ) {
+				continue;
+			}
+			// nowhere to report it from this thread
+			break;
+		}
+		if ( pollfd[ 0 ].revents & POLLIN ) {
+			break;
+		}
+		if ( pollfd[ 1 ].revents & POLLIN ) {
+			r = read( timer_fd, & expirations, sizeof( expirations ) );
+			if ( sizeof( expirations ) == r ) {
+				tick( expirations );
+			}
+		}
+	}
+}
+
+void GpioSampler::tick( uint64_t expirations ) {
+	int r;
+	char buf[ 16 ];
+	uint64_t t;
+	uint64_t errors;
+	uint64_t *column;
+	size_t i;
+
+	if ( 0 == expirations ) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard( lock );
+		stats.ticks += expirations;
+		stats.missed += expirations - 1;
+		t = stats.ticks - 1;
+	}
+
+	// a chunk only ever covers consecutive ticks
+	if ( NULL != current && current->tick + current->count != t ) {
+		hand_off();
+	}
+
+	if ( NULL == current ) {
+		std::lock_guard<std::mutex> guard( lock );
+		if ( free_chunks.empty() ) {
+			stats.overruns++;
+			return;
+		}
+		current = free_chunks.back();
+		free_chunks.pop_back();
+		current->tick = t;
+		current->count = 0;
+		std::fill( current->bits.begin(), current->bits.end(), 0 );
+	}
+
+	// a raw pread per GPIO on a descriptor that stays open is the cheapest read sysfs offers
+	errors = 0;
+	for( i = 0; i < fds.size(); i++ ) {
+		r = pread( fds[ i ], buf, sizeof( buf ), 0 );
+		if ( r <= 0 ) {
+			errors++;
+			continue;
+		}
+		if ( '1' == buf[ 0 ] ) {
+			column = current->bits.data() + i * current->stride;
+			column[ current->count / 64 ] |= (uint64_t) 1 << ( current->count % 64 );
+		}
+	}
+	current->count++;
+
+	{
+		std::lock_guard<std::mutex> guard( lock );
+		stats.samples++;
+		stats.errors += errors;
+	}
+
+	if ( chunk_samples == current->count ) {
+		hand_off();
+	}
+}
+
+void GpioSampler::hand_off() {
+	if ( NULL == current ) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> guard( lock );
+		if ( current->count > 0 ) {
+			full_chunks.push_back( current );
+		} else {
+			free_chunks.push_back( current );
+		}
+		current = NULL;
+	}
+	cv.notify_one();
+}
+
+GpioVcdWriter::GpioVcdWriter( std::ostream &os, const std::vector<uint16_t> &nums, std::chrono::nanoseconds period )
+:
+	os( os ),
+	period( period ),
+	last( nums.size(), -1 )
+{
+	std::string id;
+	size_t n;
+
+	// identifiers are base-94 numbers in the printable characters '!' to '~'
+	for( size_t i = 0; i < nums.size(); i++ ) {
+		id.clear();
+		n = i;
+		do {
+			id += (char)( '!' + n % 94 );
+			n /= 94;
+		} while( n > 0 );
+		ids.push_back( id );
+	}
+
+	os << "$version libgpio $end" << std::endl;
+	os << "$timescale 1ns $end" << std::endl;
+	os << "$scope module gpio $end" << std::endl;
+	for( size_t i = 0; i < nums.size(); i++ ) {
+		os << "$var wire 1 " << ids[ i ] << " gpio" << nums[ i ] << " $end" << std::endl;
+	}
+	os << "$upscope $end" << std::endl;
+	os << "$enddefinitions $end" << std::endl;
+}
+
+GpioVcdWriter::~GpioVcdWriter() {
+}
+
+void GpioVcdWriter::write( const GpioSampleChunk &chunk ) {
+	size_t w;
+	size_t i;
+	unsigned b;
+	uint64_t word;
+	uint64_t prev;
+	uint64_t valid;
+	uint64_t changed;
+	const uint64_t *column;
+
+	for( w = 0; w * 64 < chunk.count; w++ ) {
+
+		valid = chunk.count - w * 64 >= 64 ? ~(uint64_t) 0 : ( (uint64_t) 1 << ( chunk.count - w * 64 ) ) - 1;
+
+		// find the samples in this word where any GPIO changes, 64 at a time
+		changed = 0;
+		for( i = 0; i < ids.size(); i++ ) {
+			column = chunk.column( i );
+			word = column[ w ];
+			if ( 0 == w ) {
+				prev = -1 == last[ i ] ? ~word & 1 : (uint64_t) last[ i ];
+			} else {
+				prev = column[ w - 1 ] >> 63;
+			}
+			changed |= word ^ ( ( word << 1 ) | prev );
+		}
+		changed &= valid;
+
+		while( 0 != changed ) {
+			b = __builtin_ctzll( changed );
+			changed &= changed - 1;
+
+			os << '#' << ( chunk.tick + w * 64 + b ) * period.count() << '\n';
+			for( i = 0; i < ids.size(); i++ ) {
+				word = ( chunk.column( i )[ w ] >> b ) & 1;
+				if ( (int) word != last[ i ] ) {
+					os << word << ids[ i ] << '\n';
+					last[ i ] = word;
+				}
+			}
+		}
+	}
+}
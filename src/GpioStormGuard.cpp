@@ -0,0 +1,113 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "libgpio/GpioStormGuard.h"
+
+using namespace ::std;
+using namespace ::com::github::cfriedt;
+
+GpioStormGuard::GpioStormGuard( const Config &config )
+:
+	cfg( config ),
+	cnt(),
+	in_storm( false ),
+	pending( 0 ),
+	window_start(),
+	window_count( 0 ),
+	interval_end()
+{
+}
+
+GpioStormGuard::~GpioStormGuard() {
+}
+
+void GpioStormGuard::config( const Config &config ) {
+	cfg = config;
+	window_count = 0;
+}
+
+const GpioStormGuard::Config &GpioStormGuard::config() {
+	return cfg;
+}
+
+bool GpioStormGuard::edge( time_point t ) {
+
+	cnt.edges++;
+
+	if ( in_storm ) {
+		pending++;
+		cnt.coalesced++;
+		return false;
+	}
+
+	if ( 0 == cfg.threshold ) {
+		return true;
+	}
+
+	if ( 0 == window_count || t - window_start >= cfg.window ) {
+		window_start = t;
+		window_count = 0;
+	}
+	window_count++;
+
+	if ( (uint64_t) window_count * 1000 > (uint64_t) cfg.threshold * cfg.window.count() ) {
+		in_storm = true;
+		pending = 0;
+		interval_end = t + cfg.interval;
+		cnt.storms++;
+	}
+
+	// the notification that starts a storm is still delivered
+	return true;
+}
+
+unsigned GpioStormGuard::flush( time_point t ) {
+	unsigned r;
+
+	r = pending;
+	pending = 0;
+
+	if ( in_storm ) {
+		if ( 0 == r ) {
+			in_storm = false;
+			window_count = 0;
+		} else {
+			interval_end = t + cfg.interval;
+		}
+	}
+
+	return r;
+}
+
+bool GpioStormGuard::storming() {
+	return in_storm;
+}
+
+GpioStormGuard::time_point GpioStormGuard::holdoff() {
+	return interval_end;
+}
+
+const GpioStormGuard::Counters &GpioStormGuard::counters() {
+	return cnt;
+}
@@ -0,0 +1,126 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <iostream>
+#include <system_error>
+
+#include "libgpio/GpioBroker.h"
+
+using namespace ::std;
+using namespace ::com::github::cfriedt;
+
+static GpioBroker *broker;
+
+static void usage( const char *argv0 ) {
+	std::cerr
+		<< "usage: " << argv0 << " [-r sysfs-root] [-m shm-name] [-s socket-path] [-i gpio]... [-o gpio]..." << std::endl
+		<< "  -r  sysfs GPIO class directory (default /sys/class/gpio)" << std::endl
+		<< "  -m  shared-memory segment name (default " GPIO_BROKER_SHM_NAME_DEFAULT ")" << std::endl
+		<< "  -s  control socket path (default " GPIO_BROKER_SOCKET_PATH_DEFAULT ")" << std::endl
+		<< "  -i  broker an input" << std::endl
+		<< "  -o  broker an output" << std::endl;
+}
+
+static void on_signal( int sig ) {
+	(void) sig;
+	if ( NULL != broker ) {
+		broker->interrupt();
+	}
+}
+
+int main( int argc, char *argv[] ) {
+	int opt;
+	long l;
+	char *end;
+	std::string shm_name = GPIO_BROKER_SHM_NAME_DEFAULT;
+	std::string socket_path = GPIO_BROKER_SOCKET_PATH_DEFAULT;
+	std::vector<std::pair<uint16_t,gpio_direction_t>> gpios;
+	struct sigaction sa;
+
+	while( -1 != ( opt = getopt( argc, argv, "r:m:s:i:o:h" ) ) ) {
+		switch( opt ) {
+		case 'r':
+			if ( -1 == gpio_sysfs_root_set( optarg ) ) {
+				std::cerr << argv[ 0 ] << ": " << optarg << ": " << strerror( errno ) << std::endl;
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'm':
+			shm_name = optarg;
+			break;
+		case 's':
+			socket_path = optarg;
+			break;
+		case 'i':
+		case 'o':
+			errno = 0;
+			l = strtol( optarg, & end, 10 );
+			if ( end == optarg || 0 != errno || l < 0 || l > USHRT_MAX ) {
+				usage( argv[ 0 ] );
+				return EXIT_FAILURE;
+			}
+			gpios.push_back( std::make_pair( (uint16_t) l, 'i' == opt ? GPIO_DIR_IN : GPIO_DIR_OUT ) );
+			break;
+		default:
+			usage( argv[ 0 ] );
+			return 'h' == opt ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	if ( optind != argc || gpios.empty() ) {
+		usage( argv[ 0 ] );
+		return EXIT_FAILURE;
+	}
+
+	try {
+		GpioBroker b( shm_name, socket_path );
+		for( auto & gpio: gpios ) {
+			b.add( gpio.first, gpio.second );
+		}
+		b.start();
+
+		broker = & b;
+		memset( & sa, 0, sizeof( sa ) );
+		sa.sa_handler = on_signal;
+		sigaction( SIGINT, & sa, NULL );
+		sigaction( SIGTERM, & sa, NULL );
+		signal( SIGPIPE, SIG_IGN );
+
+		b.run();
+
+		broker = NULL;
+	} catch( std::system_error &e ) {
+		broker = NULL;
+		std::cerr << argv[ 0 ] << ": " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,453 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <dirent.h>
+#include <pthread.h>
+
+#include <string.h>
+#include <errno.h>
+
+#include "libgpio/libgpio.h"
+#include "libgpio/gpiochip.h"
+
+#define GPIO_CHIP_PREFIX "gpiochip"
+
+typedef struct {
+	gpio_chip_t *chip;
+	unsigned nchips;
+
+	// open-addressed hash of label -> index into chip, -1 marks an empty slot
+	int *label;
+	unsigned label_mask;
+
+	// index into chip + 1 for each gpio in [ gpio_lo, gpio_lo + gpio_span ), 0 if none
+	uint16_t *gpio;
+	uint16_t gpio_lo;
+	uint32_t gpio_span;
+} gpio_chip_index_t;
+
+static pthread_mutex_t gpio_chip_lock = PTHREAD_MUTEX_INITIALIZER;
+static gpio_chip_index_t gpio_chip_index;
+static bool gpio_chip_index_valid;
+// bumped by gpio_chip_invalidate(), so an index built meanwhile is not installed
+static unsigned gpio_chip_generation;
+
+static uint32_t gpio_chip_hash( const char *s ) {
+	// FNV-1a
+	uint32_t h = 2166136261u;
+	for( ; '\0' != *s; s++ ) {
+		h ^= (uint8_t) *s;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static void gpio_chip_index_free( gpio_chip_index_t *idx ) {
+	free( idx->chip );
+	free( idx->label );
+	free( idx->gpio );
+	memset( idx, 0, sizeof( *idx ) );
+}
+
+static int gpio_chip_read_attr( const char *chip, const char *attr, char *buf, size_t len ) {
+	int r;
+	int fd;
+	char fn[ PATH_MAX ];
+
+	memset( fn, 0, sizeof( fn ) );
+	snprintf( fn, sizeof( fn ) - 1, "%s/%s/%s", gpio_sysfs_root_get(), chip, attr );
+
+	r = open( fn, O_RDONLY );
+	if ( -1 == r ) {
+		goto out;
+	}
+	fd = r;
+
+	memset( buf, 0, len );
+	r = read( fd, buf, len - 1 );
+	if ( -1 == r ) {
+		goto closefd;
+	}
+	if ( r > 0 && '\n' == buf[ r - 1 ] ) {
+		buf[ r - 1 ] = '\0';
+	}
+
+	r = EXIT_SUCCESS;
+
+closefd:
+	close( fd );
+
+out:
+	return r;
+}
+
+static int gpio_chip_read_u16( const char *chip, const char *attr, uint16_t *val ) {
+	int r;
+	char buf[ 16 ];
+	char *end;
+	long l;
+
+	r = gpio_chip_read_attr( chip, attr, buf, sizeof( buf ) );
+	if ( -1 == r ) {
+		goto out;
+	}
+
+	errno = 0;
+	l = strtol( buf, &end, 10 );
+	if ( end == buf || 0 != errno || l < 0 || l > UINT16_MAX ) {
+		errno = EINVAL;
+		r = -1;
+		goto out;
+	}
+	*val = l;
+
+	r = EXIT_SUCCESS;
+
+out:
+	return r;
+}
+
+static int gpio_chip_cmp( const void *a, const void *b ) {
+	const gpio_chip_t *aa = a;
+	const gpio_chip_t *bb = b;
+	return (int) aa->base - (int) bb->base;
+}
+
+static int gpio_chip_index_build( gpio_chip_index_t *idx ) {
+	int r;
+	DIR *dir;
+	struct dirent *de;
+	gpio_chip_t *chip;
+	unsigned cap;
+	unsigned i;
+	unsigned j;
+	uint32_t hi;
+
+	memset( idx, 0, sizeof( *idx ) );
+
+	dir = opendir( gpio_sysfs_root_get() );
+	if ( NULL == dir ) {
+		r = -1;
+		goto out;
+	}
+
+	cap = 0;
+	for( ;; ) {
+		errno = 0;
+		de = readdir( dir );
+		if ( NULL == de ) {
+			if ( 0 != errno ) {
+				r = -1;
+				goto closedir;
+			}
+			break;
+		}
+		if ( 0 != strncmp( de->d_name, GPIO_CHIP_PREFIX, strlen( GPIO_CHIP_PREFIX ) ) ) {
+			continue;
+		}
+		if ( idx->nchips == cap ) {
+			cap = 0 == cap ? 8 : 2 * cap;
+			chip = realloc( idx->chip, cap * sizeof( *chip ) );
+			if ( NULL == chip ) {
+				r = -1;
+				goto closedir;
+			}
+			idx->chip = chip;
+		}
+		if ( strlen( de->d_name ) >= sizeof( chip->name ) ) {
+			continue;
+		}
+		chip = & idx->chip[ idx->nchips ];
+		memset( chip, 0, sizeof( *chip ) );
+		memcpy( chip->name, de->d_name, strlen( de->d_name ) );
+		// a chip whose attributes cannot be read is left out rather than failing the scan
+		if ( -1 == gpio_chip_read_u16( chip->name, "base", & chip->base )
+			|| -1 == gpio_chip_read_u16( chip->name, "ngpio", & chip->ngpio )
+			|| -1 == gpio_chip_read_attr( chip->name, "label", chip->label, sizeof( chip->label ) ) )
+		{
+			continue;
+		}
+		idx->nchips++;
+	}
+
+	qsort( idx->chip, idx->nchips, sizeof( *idx->chip ), gpio_chip_cmp );
+
+	// label hash, at most half full
+	for( cap = 4; cap < 2 * idx->nchips; cap *= 2 );
+	idx->label = malloc( cap * sizeof( *idx->label ) );
+	if ( NULL == idx->label ) {
+		r = -1;
+		goto closedir;
+	}
+	memset( idx->label, 0xff, cap * sizeof( *idx->label ) );
+	idx->label_mask = cap - 1;
+	for( i = 0; i < idx->nchips; i++ ) {
+		for( j = gpio_chip_hash( idx->chip[ i ].label ) & idx->label_mask; -1 != idx->label[ j ]; j = ( j + 1 ) & idx->label_mask ) {
+			if ( 0 == strcmp( idx->chip[ idx->label[ j ] ].label, idx->chip[ i ].label ) ) {
+				break;
+			}
+		}
+		if ( -1 == idx->label[ j ] ) {
+			idx->label[ j ] = i;
+		}
+	}
+
+	// dense gpio -> chip table spanning all chips
+	if ( idx->nchips > 0 ) {
+		idx->gpio_lo = idx->chip[ 0 ].base;
+		hi = idx->gpio_lo;
+		for( i = 0; i < idx->nchips; i++ ) {
+			if ( (uint32_t) idx->chip[ i ].base + idx->chip[ i ].ngpio > hi ) {
+				hi = (uint32_t) idx->chip[ i ].base + idx->chip[ i ].ngpio;
+			}
+		}
+		idx->gpio_span = hi - idx->gpio_lo;
+		idx->gpio = calloc( idx->gpio_span + 1, sizeof( *idx->gpio ) );
+		if ( NULL == idx->gpio ) {
+			r = -1;
+			goto closedir;
+		}
+		for( i = 0; i < idx->nchips; i++ ) {
+			for( j = 0; j < idx->chip[ i ].ngpio; j++ ) {
+				idx->gpio[ idx->chip[ i ].base - idx->gpio_lo + j ] = i + 1;
+			}
+		}
+	}
+
+	r = idx->nchips;
+
+closedir:
+	closedir( dir );
+	if ( -1 == r ) {
+		gpio_chip_index_free( idx );
+	}
+
+out:
+	return r;
+}
+
+// must be called with gpio_chip_lock held
+static int gpio_chip_index_ensure( void ) {
+	int r;
+
+	if ( gpio_chip_index_valid ) {
+		r = EXIT_SUCCESS;
+		goto out;
+	}
+
+	r = gpio_chip_index_build( & gpio_chip_index );
+	if ( -1 == r ) {
+		goto out;
+	}
+	gpio_chip_index_valid = true;
+
+	r = EXIT_SUCCESS;
+
+out:
+	return r;
+}
+
+// must be called with gpio_chip_lock held
+static int gpio_chip_index_label( const char *label ) {
+	unsigned j;
+	int i;
+
+	for( j = gpio_chip_hash( label ) & gpio_chip_index.label_mask; -1 != ( i = gpio_chip_index.label[ j ] ); j = ( j + 1 ) & gpio_chip_index.label_mask ) {
+		if ( 0 == strcmp( gpio_chip_index.chip[ i ].label, label ) ) {
+			return i;
+		}
+	}
+
+	errno = ENOENT;
+	return -1;
+}
+
+void gpio_chip_invalidate( void ) {
+	pthread_mutex_lock( & gpio_chip_lock );
+	gpio_chip_index_free( & gpio_chip_index );
+	gpio_chip_index_valid = false;
+	gpio_chip_generation++;
+	pthread_mutex_unlock( & gpio_chip_lock );
+}
+
+int gpio_chip_refresh( void ) {
+	int r;
+	unsigned generation;
+	gpio_chip_index_t idx;
+
+	pthread_mutex_lock( & gpio_chip_lock );
+	generation = gpio_chip_generation;
+	pthread_mutex_unlock( & gpio_chip_lock );
+
+	for( ;; ) {
+		// scan without the lock, so lookups are not held up by sysfs
+		r = gpio_chip_index_build( & idx );
+		if ( -1 == r ) {
+			goto out;
+		}
+
+		pthread_mutex_lock( & gpio_chip_lock );
+		if ( generation == gpio_chip_generation ) {
+			break;
+		}
+		// invalidated while scanning, e.g. the sysfs root changed, so scan again
+		generation = gpio_chip_generation;
+		pthread_mutex_unlock( & gpio_chip_lock );
+		gpio_chip_index_free( & idx );
+	}
+
+	gpio_chip_index_free( & gpio_chip_index );
+	gpio_chip_index = idx;
+	gpio_chip_index_valid = true;
+	pthread_mutex_unlock( & gpio_chip_lock );
+
+out:
+	return r;
+}
+
+int gpio_chip_count( void ) {
+	int r;
+
+	pthread_mutex_lock( & gpio_chip_lock );
+	r = gpio_chip_index_ensure();
+	if ( -1 == r ) {
+		goto unlock;
+	}
+	r = gpio_chip_index.nchips;
+
+unlock:
+	pthread_mutex_unlock( & gpio_chip_lock );
+	return r;
+}
+
+int gpio_chip_get( unsigned idx, gpio_chip_t *chip ) {
+	int r;
+
+	pthread_mutex_lock( & gpio_chip_lock );
+	r = gpio_chip_index_ensure();
+	if ( -1 == r ) {
+		goto unlock;
+	}
+	if ( idx >= gpio_chip_index.nchips ) {
+		errno = ERANGE;
+		r = -1;
+		goto unlock;
+	}
+	*chip = gpio_chip_index.chip[ idx ];
+
+	r = EXIT_SUCCESS;
+
+unlock:
+	pthread_mutex_unlock( & gpio_chip_lock );
+	return r;
+}
+
+int gpio_chip_find( const char *label, gpio_chip_t *chip ) {
+	int r;
+
+	pthread_mutex_lock( & gpio_chip_lock );
+	r = gpio_chip_index_ensure();
+	if ( -1 == r ) {
+		goto unlock;
+	}
+	r = gpio_chip_index_label( label );
+	if ( -1 == r ) {
+		goto unlock;
+	}
+	*chip = gpio_chip_index.chip[ r ];
+
+	r = EXIT_SUCCESS;
+
+unlock:
+	pthread_mutex_unlock( & gpio_chip_lock );
+	return r;
+}
+
+int gpio_chip_find_gpio( uint16_t gpio, gpio_chip_t *chip, uint16_t *offset ) {
+	int r;
+	unsigned i;
+
+	pthread_mutex_lock( & gpio_chip_lock );
+	r = gpio_chip_index_ensure();
+	if ( -1 == r ) {
+		goto unlock;
+	}
+	if ( gpio < gpio_chip_index.gpio_lo
+		|| (uint32_t)( gpio - gpio_chip_index.gpio_lo ) >= gpio_chip_index.gpio_span
+		|| 0 == gpio_chip_index.gpio[ gpio - gpio_chip_index.gpio_lo ] )
+	{
+		errno = ENOENT;
+		r = -1;
+		goto unlock;
+	}
+	i = gpio_chip_index.gpio[ gpio - gpio_chip_index.gpio_lo ] - 1;
+	if ( NULL != chip ) {
+		*chip = gpio_chip_index.chip[ i ];
+	}
+	if ( NULL != offset ) {
+		*offset = gpio - gpio_chip_index.chip[ i ].base;
+	}
+
+	r = EXIT_SUCCESS;
+
+unlock:
+	pthread_mutex_unlock( & gpio_chip_lock );
+	return r;
+}
+
+int gpio_chip_gpio( const char *label, uint16_t offset, uint16_t *gpio ) {
+	int r;
+	const gpio_chip_t *chip;
+
+	pthread_mutex_lock( & gpio_chip_lock );
+	r = gpio_chip_index_ensure();
+	if ( -1 == r ) {
+		goto unlock;
+	}
+	r = gpio_chip_index_label( label );
+	if ( -1 == r ) {
+		goto unlock;
+	}
+	chip = & gpio_chip_index.chip[ r ];
+	if ( offset >= chip->ngpio ) {
+		errno = ERANGE;
+		r = -1;
+		goto unlock;
+	}
+	*gpio = chip->base + offset;
+
+	r = EXIT_SUCCESS;
+
+unlock:
+	pthread_mutex_unlock( & gpio_chip_lock );
+	return r;
+}
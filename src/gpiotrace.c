@@ -0,0 +1,394 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+
+#include <string.h>
+#include <errno.h>
+
+#include "libgpio/gpiotrace.h"
+
+#define GPIO_TRACE_BUF_EVENTS 256
+
+typedef struct gpio_trace_buf {
+	struct gpio_trace_buf *next;
+	// 1 while a thread owns the buffer
+	int in_use;
+	// 1 while the owner is appending or flushing
+	int busy;
+	uint32_t tid;
+	unsigned n;
+	gpio_trace_event_t ev[ GPIO_TRACE_BUF_EVENTS ];
+} gpio_trace_buf_t;
+
+int gpio_trace_enabled;
+
+static int gpio_trace_fd = -1;
+// the first error writing events, reported by gpio_trace_stop()
+static int gpio_trace_errno;
+static gpio_trace_buf_t *gpio_trace_bufs;
+static __thread gpio_trace_buf_t *gpio_trace_tls;
+static pthread_key_t gpio_trace_key;
+static pthread_once_t gpio_trace_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t gpio_trace_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *gpio_trace_op_str[ GPIO_TRACE_OP_MAX ] = {
+	[ GPIO_TRACE_OP_PROP_GET ] = "get",
+	[ GPIO_TRACE_OP_PROP_SET ] = "set",
+	[ GPIO_TRACE_OP_PROP_READ ] = "read",
+	[ GPIO_TRACE_OP_PROP_WRITE ] = "write",
+	[ GPIO_TRACE_OP_IS_EXPORTED ] = "is_exported",
+	[ GPIO_TRACE_OP_EXPORT ] = "export",
+	[ GPIO_TRACE_OP_UNEXPORT ] = "unexport",
+	[ GPIO_TRACE_OP_EXPORT_BULK ] = "export_bulk",
+	[ GPIO_TRACE_OP_WAIT ] = "wait",
+	[ GPIO_TRACE_OP_INTERRUPT ] = "interrupt",
+};
+
+// names of arg[ 0 ] and arg[ 1 ] in JSON, "arg0" and "arg1" where missing
+static const char *gpio_trace_arg_str[ GPIO_TRACE_OP_MAX ][ 2 ] = {
+	[ GPIO_TRACE_OP_PROP_GET ] = { "prop", "value" },
+	[ GPIO_TRACE_OP_PROP_SET ] = { "prop", "value" },
+	[ GPIO_TRACE_OP_PROP_READ ] = { "prop", "value" },
+	[ GPIO_TRACE_OP_PROP_WRITE ] = { "prop", "value" },
+	[ GPIO_TRACE_OP_IS_EXPORTED ] = { "exported", NULL },
+	[ GPIO_TRACE_OP_EXPORT_BULK ] = { "count", "timeout_ms" },
+	[ GPIO_TRACE_OP_WAIT ] = { "timeout_us", NULL },
+	[ GPIO_TRACE_OP_INTERRUPT ] = { "fd", NULL },
+};
+
+static const char *gpio_trace_prop_str[] = {
+	"value",
+	"direction",
+	"edge",
+};
+
+uint64_t gpio_trace_now( void ) {
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, & ts );
+	// never 0, which GPIO_TRACE_END() reads as "not tracing"
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec + 1;
+}
+
+// must be called with buf->busy set
+static int gpio_trace_flush( gpio_trace_buf_t *buf ) {
+	int r;
+	int fd;
+	int expected;
+	size_t len;
+
+	r = EXIT_SUCCESS;
+
+	fd = __atomic_load_n( & gpio_trace_fd, __ATOMIC_ACQUIRE );
+	if ( buf->n > 0 && -1 != fd ) {
+		len = buf->n * sizeof( buf->ev[ 0 ] );
+		// O_APPEND keeps whole buffers from different threads from interleaving
+		r = write( fd, buf->ev, len );
+		if ( len != (size_t) r ) {
+			if ( -1 != r ) {
+				errno = EIO;
+			}
+			r = -1;
+			expected = 0;
+			__atomic_compare_exchange_n( & gpio_trace_errno, & expected, errno, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED );
+		} else {
+			r = EXIT_SUCCESS;
+		}
+	}
+	buf->n = 0;
+
+	return r;
+}
+
+static void gpio_trace_thread_exit( void *arg ) {
+	gpio_trace_buf_t *buf = arg;
+
+	__atomic_store_n( & buf->busy, 1, __ATOMIC_SEQ_CST );
+	if ( __atomic_load_n( & gpio_trace_enabled, __ATOMIC_SEQ_CST ) ) {
+		gpio_trace_flush( buf );
+	}
+	__atomic_store_n( & buf->busy, 0, __ATOMIC_RELEASE );
+	__atomic_store_n( & buf->in_use, 0, __ATOMIC_RELEASE );
+}
+
+static void gpio_trace_key_create( void ) {
+	pthread_key_create( & gpio_trace_key, gpio_trace_thread_exit );
+}
+
+static gpio_trace_buf_t *gpio_trace_buf_get( void ) {
+	gpio_trace_buf_t *buf;
+	int expected;
+
+	if ( NULL != gpio_trace_tls ) {
+		return gpio_trace_tls;
+	}
+
+	pthread_once( & gpio_trace_once, gpio_trace_key_create );
+
+	// reuse the buffer of a thread that has exited
+	for( buf = __atomic_load_n( & gpio_trace_bufs, __ATOMIC_ACQUIRE ); NULL != buf; buf = buf->next ) {
+		expected = 0;
+		if ( __atomic_compare_exchange_n( & buf->in_use, & expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ) ) {
+			break;
+		}
+	}
+
+	if ( NULL == buf ) {
+		buf = calloc( 1, sizeof( *buf ) );
+		if ( NULL == buf ) {
+			return NULL;
+		}
+		buf->in_use = 1;
+		buf->next = __atomic_load_n( & gpio_trace_bufs, __ATOMIC_RELAXED );
+		while( ! __atomic_compare_exchange_n( & gpio_trace_bufs, & buf->next, buf, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED ) );
+	}
+
+	buf->tid = syscall( SYS_gettid );
+	pthread_setspecific( gpio_trace_key, buf );
+	gpio_trace_tls = buf;
+
+	return buf;
+}
+
+void gpio_trace_record( unsigned op, uint16_t gpio, int32_t arg0, int32_t arg1, uint64_t start_ns, bool failed ) {
+	int err;
+	gpio_trace_buf_t *buf;
+	gpio_trace_event_t *ev;
+
+	err = errno;
+
+	buf = gpio_trace_buf_get();
+	if ( NULL == buf ) {
+		goto out;
+	}
+
+	// pairs with gpio_trace_stop(), which clears gpio_trace_enabled before it waits for busy
+	__atomic_store_n( & buf->busy, 1, __ATOMIC_SEQ_CST );
+	if ( ! __atomic_load_n( & gpio_trace_enabled, __ATOMIC_SEQ_CST ) ) {
+		goto notbusy;
+	}
+
+	ev = & buf->ev[ buf->n++ ];
+	ev->start_ns = start_ns;
+	ev->end_ns = gpio_trace_now();
+	ev->tid = buf->tid;
+	ev->op = op;
+	ev->gpio = gpio;
+	ev->arg[ 0 ] = arg0;
+	ev->arg[ 1 ] = arg1;
+	ev->err = failed ? err : 0;
+	ev->reserved = 0;
+
+	if ( GPIO_TRACE_BUF_EVENTS == buf->n ) {
+		gpio_trace_flush( buf );
+	}
+
+notbusy:
+	__atomic_store_n( & buf->busy, 0, __ATOMIC_RELEASE );
+
+out:
+	errno = err;
+}
+
+int gpio_trace_start( const char *path ) {
+	int r;
+	int fd;
+	gpio_trace_header_t hdr;
+
+	pthread_mutex_lock( & gpio_trace_lock );
+
+	if ( -1 != gpio_trace_fd ) {
+		errno = EBUSY;
+		r = -1;
+		goto unlock;
+	}
+
+	r = open( path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644 );
+	if ( -1 == r ) {
+		goto unlock;
+	}
+	fd = r;
+
+	memset( & hdr, 0, sizeof( hdr ) );
+	memcpy( hdr.magic, GPIO_TRACE_MAGIC, sizeof( GPIO_TRACE_MAGIC ) );
+	hdr.version = GPIO_TRACE_VERSION;
+	hdr.event_size = sizeof( gpio_trace_event_t );
+	hdr.pid = getpid();
+	r = write( fd, & hdr, sizeof( hdr ) );
+	if ( sizeof( hdr ) != r ) {
+		if ( -1 != r ) {
+			errno = EIO;
+		}
+		r = -1;
+		close( fd );
+		goto unlock;
+	}
+
+	__atomic_store_n( & gpio_trace_errno, 0, __ATOMIC_RELAXED );
+	__atomic_store_n( & gpio_trace_fd, fd, __ATOMIC_RELEASE );
+	__atomic_store_n( & gpio_trace_enabled, 1, __ATOMIC_SEQ_CST );
+
+	r = EXIT_SUCCESS;
+
+unlock:
+	pthread_mutex_unlock( & gpio_trace_lock );
+	return r;
+}
+
+int gpio_trace_stop( void ) {
+	int r;
+	int err;
+	gpio_trace_buf_t *buf;
+
+	pthread_mutex_lock( & gpio_trace_lock );
+
+	if ( -1 == gpio_trace_fd ) {
+		errno = EINVAL;
+		r = -1;
+		goto unlock;
+	}
+
+	__atomic_store_n( & gpio_trace_enabled, 0, __ATOMIC_SEQ_CST );
+
+	for( buf = __atomic_load_n( & gpio_trace_bufs, __ATOMIC_ACQUIRE ); NULL != buf; buf = buf->next ) {
+		// an owner that saw tracing enabled finishes its event first
+		while( __atomic_load_n( & buf->busy, __ATOMIC_SEQ_CST ) ) {
+			sched_yield();
+		}
+		gpio_trace_flush( buf );
+	}
+
+	r = close( gpio_trace_fd );
+	__atomic_store_n( & gpio_trace_fd, -1, __ATOMIC_RELEASE );
+
+	// events may have been lost well before now, from any thread
+	err = __atomic_exchange_n( & gpio_trace_errno, 0, __ATOMIC_SEQ_CST );
+	if ( 0 != err ) {
+		errno = err;
+		r = -1;
+	}
+
+unlock:
+	pthread_mutex_unlock( & gpio_trace_lock );
+	return r;
+}
+
+int gpio_trace_to_json( const char *in, const char *out ) {
+	int r;
+	FILE *fin;
+	FILE *fout;
+	gpio_trace_header_t hdr;
+	gpio_trace_event_t ev;
+	const char *op;
+	const char *prop;
+	const char *arg[ 2 ];
+	unsigned n;
+	unsigned i;
+
+	fin = fopen( in, "rb" );
+	if ( NULL == fin ) {
+		r = -1;
+		goto out;
+	}
+
+	if ( 1 != fread( & hdr, sizeof( hdr ), 1, fin )
+		|| 0 != memcmp( hdr.magic, GPIO_TRACE_MAGIC, sizeof( GPIO_TRACE_MAGIC ) )
+		|| hdr.version < 1
+		|| hdr.version > GPIO_TRACE_VERSION
+		|| sizeof( ev ) != hdr.event_size )
+	{
+		errno = EPROTO;
+		r = -1;
+		goto closein;
+	}
+
+	fout = fopen( out, "w" );
+	if ( NULL == fout ) {
+		r = -1;
+		goto closein;
+	}
+
+	fprintf( fout, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[" );
+
+	for( n = 0; 1 == fread( & ev, sizeof( ev ), 1, fin ); n++ ) {
+		op = ev.op < GPIO_TRACE_OP_MAX ? gpio_trace_op_str[ ev.op ] : "unknown";
+		prop = NULL;
+		if ( ev.op <= GPIO_TRACE_OP_PROP_WRITE && ev.arg[ 0 ] >= 0 && ev.arg[ 0 ] < (int32_t)( sizeof( gpio_trace_prop_str ) / sizeof( gpio_trace_prop_str[ 0 ] ) ) ) {
+			prop = gpio_trace_prop_str[ ev.arg[ 0 ] ];
+		}
+
+		fprintf( fout, "%s\n{\"name\":\"%s%s%s\",\"cat\":\"libgpio\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{",
+			0 == n ? "" : ",",
+			NULL == prop ? "" : prop,
+			NULL == prop ? "" : "_",
+			op,
+			hdr.pid,
+			ev.tid,
+			ev.start_ns / 1000.0,
+			( ev.end_ns - ev.start_ns ) / 1000.0
+		);
+		if ( GPIO_TRACE_GPIO_NONE != ev.gpio ) {
+			fprintf( fout, "\"gpio\":%u,", ev.gpio );
+		}
+		for( i = 0; i < 2; i++ ) {
+			arg[ i ] = ev.op < GPIO_TRACE_OP_MAX ? gpio_trace_arg_str[ ev.op ][ i ] : NULL;
+		}
+		if ( GPIO_TRACE_OP_WAIT == ev.op && 1 == hdr.version ) {
+			arg[ 0 ] = "timeout_ms";
+		}
+		fprintf( fout, "\"%s\":%d,\"%s\":%d,\"errno\":%d}}",
+			NULL == arg[ 0 ] ? "arg0" : arg[ 0 ],
+			ev.arg[ 0 ],
+			NULL == arg[ 1 ] ? "arg1" : arg[ 1 ],
+			ev.arg[ 1 ],
+			ev.err
+		);
+	}
+
+	fprintf( fout, "\n]}\n" );
+
+	r = n;
+	if ( ferror( fin ) ) {
+		r = -1;
+	}
+	if ( 0 != fclose( fout ) ) {
+		r = -1;
+	}
+
+closein:
+	fclose( fin );
+
+out:
+	return r;
+}
@@ -29,11 +29,17 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/inotify.h>
 
 #include <string.h>
 #include <errno.h>
 
 #include "libgpio/libgpio.h"
+#include "libgpio/gpiochip.h"
+#include "libgpio/gpiotrace.h"
 
 #ifndef min
 #define min( a, b ) ( (a) < (b) ? (a) : (b) )
@@ -41,6 +47,11 @@
 
 #define GPIO_PROP_DESC_NVALS_MAX 4
 
+#define GPIO_SYSFS_ROOT_DEFAULT "/sys/class/gpio"
+
+// leaves room in a PATH_MAX buffer for the longest suffix, "/gpio65535/direction"
+static char gpio_sysfs_root[ PATH_MAX - 32 ] = GPIO_SYSFS_ROOT_DEFAULT;
+
 typedef struct {
 	gpio_prop_t type;
 	const char *type_str;
@@ -80,66 +91,138 @@ static const gpio_prop_desc_t gpio_desc[] = {
 	},
 };
 
-static int gpio_prop( uint16_t gpio, gpio_prop_t prop, unsigned *eval, bool set ) {
+int gpio_sysfs_root_set( const char *root ) {
 	int r;
 
-	char sys_class_gpio_gpioN_prop_fn[ 64 ];
-	char prop_str_buf[ 16 ];
-	int fd;
-	int i;
+	if ( NULL == root ) {
+		root = GPIO_SYSFS_ROOT_DEFAULT;
+	}
+	if ( strlen( root ) >= sizeof( gpio_sysfs_root ) ) {
+		errno = ENAMETOOLONG;
+		r = -1;
+		goto out;
+	}
+
+	memset( gpio_sysfs_root, 0, sizeof( gpio_sysfs_root ) );
+	strncpy( gpio_sysfs_root, root, sizeof( gpio_sysfs_root ) - 1 );
+
+	// chips found under the old root mean nothing under the new one
+	gpio_chip_invalidate();
+
+	r = EXIT_SUCCESS;
+
+out:
+	return r;
+}
+const char *gpio_sysfs_root_get( void ) {
+	return gpio_sysfs_root;
+}
+
+int gpio_prop_open( uint16_t gpio, gpio_prop_t prop ) {
+	char sys_class_gpio_gpioN_prop_fn[ PATH_MAX ];
 
 	memset( sys_class_gpio_gpioN_prop_fn, 0, sizeof( sys_class_gpio_gpioN_prop_fn ) );
 	snprintf( sys_class_gpio_gpioN_prop_fn, sizeof( sys_class_gpio_gpioN_prop_fn ) - 1,
-		"/sys/class/gpio/gpio%u/%s",
+		"%s/gpio%u/%s",
+		gpio_sysfs_root,
 		gpio,
 		gpio_desc[ prop ].type_str
 	);
 
-	r = open( sys_class_gpio_gpioN_prop_fn, O_RDWR );
+	return open( sys_class_gpio_gpioN_prop_fn, O_RDWR | O_CLOEXEC );
+}
+static int gpio_prop_write_( int fd, gpio_prop_t prop, unsigned eval ) {
+	int r;
+
+	if ( eval >= gpio_desc[ prop ].nvals ) {
+		errno = EINVAL;
+		r = -1;
+		goto out;
+	}
+	r = pwrite( fd, gpio_desc[ prop ].val[ eval ], strlen( gpio_desc[ prop ].val[ eval ] ), 0 );
 	if ( -1 == r ) {
 		goto out;
 	}
-	fd = r;
 
-	if ( set ) {
-		if ( *eval >= gpio_desc[ prop ].nvals ) {
-			errno = EINVAL;
-			r = -1;
-			goto closefd;
-		}
-		r = write( fd, gpio_desc[ prop ].val[ *eval ], strlen( gpio_desc[ prop ].val[ *eval ] ) );
-		if ( -1 == r ) {
-			goto closefd;
-		}
-	} else {
-		memset( prop_str_buf, 0, sizeof( prop_str_buf ) );
-		r = read( fd, prop_str_buf, sizeof( prop_str_buf ) );
-		if ( -1 == r ) {
-			goto closefd;
-		}
-		if ( '\n' == prop_str_buf[ r - 1 ] ) {
-			prop_str_buf[ r - 1 ] = '\0';
-			r--;
-		}
-		for( i = 0; i < gpio_desc[ prop ].nvals; i++ ) {
-			if ( 0 == strncmp( gpio_desc[ prop ].val[ i ], prop_str_buf, min( strlen( gpio_desc[ prop ].val[ i ] ), r ) ) ) {
-				*eval = i;
-				break;
-			}
-		}
-		if ( i >= gpio_desc[ prop ].nvals ) {
-			r = -1;
-			errno = EINVAL;
-			goto closefd;
+	r = EXIT_SUCCESS;
+
+out:
+	return r;
+}
+static int gpio_prop_read_( int fd, gpio_prop_t prop, unsigned *eval ) {
+	int r;
+
+	char prop_str_buf[ 16 ];
+	unsigned i;
+
+	memset( prop_str_buf, 0, sizeof( prop_str_buf ) );
+	r = pread( fd, prop_str_buf, sizeof( prop_str_buf ), 0 );
+	if ( -1 == r ) {
+		goto out;
+	}
+	if ( r > 0 && '\n' == prop_str_buf[ r - 1 ] ) {
+		prop_str_buf[ r - 1 ] = '\0';
+		r--;
+	}
+	for( i = 0; r > 0 && i < gpio_desc[ prop ].nvals; i++ ) {
+		if ( 0 == strncmp( gpio_desc[ prop ].val[ i ], prop_str_buf, min( strlen( gpio_desc[ prop ].val[ i ] ), (size_t) r ) ) ) {
+			*eval = i;
+			break;
 		}
 	}
+	if ( r <= 0 || i >= gpio_desc[ prop ].nvals ) {
+		r = -1;
+		errno = EINVAL;
+		goto out;
+	}
 
 	r = EXIT_SUCCESS;
 
-closefd:
+out:
+	return r;
+}
+
+int gpio_prop_write( int fd, gpio_prop_t prop, unsigned eval ) {
+	int r;
+
+	GPIO_TRACE_BEGIN( t );
+	r = gpio_prop_write_( fd, prop, eval );
+	GPIO_TRACE_END( t, GPIO_TRACE_OP_PROP_WRITE, GPIO_TRACE_GPIO_NONE, prop, eval, r );
+
+	return r;
+}
+int gpio_prop_read( int fd, gpio_prop_t prop, unsigned *eval ) {
+	int r;
+
+	GPIO_TRACE_BEGIN( t );
+	r = gpio_prop_read_( fd, prop, eval );
+	GPIO_TRACE_END( t, GPIO_TRACE_OP_PROP_READ, GPIO_TRACE_GPIO_NONE, prop, -1 == r ? -1 : (int32_t) *eval, r );
+
+	return r;
+}
+
+static int gpio_prop( uint16_t gpio, gpio_prop_t prop, unsigned *eval, bool set ) {
+	int r;
+	int fd;
+
+	GPIO_TRACE_BEGIN( t );
+
+	r = gpio_prop_open( gpio, prop );
+	if ( -1 == r ) {
+		goto out;
+	}
+	fd = r;
+
+	if ( set ) {
+		r = gpio_prop_write_( fd, prop, *eval );
+	} else {
+		r = gpio_prop_read_( fd, prop, eval );
+	}
+
 	close( fd );
 
 out:
+	GPIO_TRACE_END( t, set ? GPIO_TRACE_OP_PROP_SET : GPIO_TRACE_OP_PROP_GET, gpio, prop, -1 == r ? -1 : (int32_t) *eval, r );
 	return r;
 }
 int gpio_direction_set( uint16_t gpio, gpio_direction_t *output ) {
@@ -165,11 +248,19 @@ static int gpio_ex_unex_port( uint16_t gpio, bool ex ) {
 	int r;
 	int fd;
 
-	const char *sys_class_gpio_export = "/sys/class/gpio/export";
-	const char *sys_class_gpio_unexport = "/sys/class/gpio/unexport";
+	char sys_class_gpio_ex_unex_port[ PATH_MAX ];
 	char buf[ 16 ];
 
-	r = open( ex ? sys_class_gpio_export : sys_class_gpio_unexport, O_WRONLY );
+	GPIO_TRACE_BEGIN( t );
+
+	memset( sys_class_gpio_ex_unex_port, 0, sizeof( sys_class_gpio_ex_unex_port ) );
+	snprintf( sys_class_gpio_ex_unex_port, sizeof( sys_class_gpio_ex_unex_port ) - 1,
+		"%s/%s",
+		gpio_sysfs_root,
+		ex ? "export" : "unexport"
+	);
+
+	r = open( sys_class_gpio_ex_unex_port, O_WRONLY );
 	if ( -1 == r ) {
 		goto out;
 	}
@@ -189,20 +280,25 @@ closefd:
 	fd = -1;
 
 out:
+	GPIO_TRACE_END( t, ex ? GPIO_TRACE_OP_EXPORT : GPIO_TRACE_OP_UNEXPORT, gpio, 0, 0, r );
 	return r;
 }
 bool gpio_is_exported( uint16_t gpio ) {
 	bool r;
 
-	char sys_class_gpio_gpioN[ 32 ];
+	char sys_class_gpio_gpioN[ PATH_MAX ];
 	int access_r;
 
+	GPIO_TRACE_BEGIN( t );
+
 	memset( sys_class_gpio_gpioN, 0, sizeof( sys_class_gpio_gpioN ) );
-	snprintf( sys_class_gpio_gpioN, sizeof( sys_class_gpio_gpioN ) - 1, "/sys/class/gpio/gpio%u", gpio );
+	snprintf( sys_class_gpio_gpioN, sizeof( sys_class_gpio_gpioN ) - 1, "%s/gpio%u", gpio_sysfs_root, gpio );
 
 	access_r = access( sys_class_gpio_gpioN, F_OK );
 	r = EXIT_SUCCESS == access_r;
 
+	GPIO_TRACE_END( t, GPIO_TRACE_OP_IS_EXPORTED, gpio, r, 0, access_r );
+
 	return r;
 }
 int gpio_export( uint16_t gpio ) {
@@ -211,3 +307,200 @@ int gpio_export( uint16_t gpio ) {
 int gpio_unexport( uint16_t gpio ) {
 	return gpio_ex_unex_port( gpio, false );
 }
+
+
+static int gpio_export_ready( uint16_t gpio ) {
+	char sys_class_gpio_gpioN_value[ PATH_MAX ];
+
+	memset( sys_class_gpio_gpioN_value, 0, sizeof( sys_class_gpio_gpioN_value ) );
+	snprintf( sys_class_gpio_gpioN_value, sizeof( sys_class_gpio_gpioN_value ) - 1, "%s/gpio%u/value", gpio_sysfs_root, gpio );
+
+	return access( sys_class_gpio_gpioN_value, W_OK );
+}
+static int gpio_export_watch( int ifd, uint16_t gpio ) {
+	char sys_class_gpio_gpioN[ PATH_MAX ];
+
+	memset( sys_class_gpio_gpioN, 0, sizeof( sys_class_gpio_gpioN ) );
+	snprintf( sys_class_gpio_gpioN, sizeof( sys_class_gpio_gpioN ) - 1, "%s/gpio%u", gpio_sysfs_root, gpio );
+
+	return inotify_add_watch( ifd, sys_class_gpio_gpioN, IN_CREATE | IN_ATTRIB | IN_MOVED_TO );
+}
+static int64_t gpio_export_now_ms( void ) {
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, & ts );
+	return (int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+int gpio_export_bulk( const uint16_t *gpio, size_t n, int timeout_ms, int *err ) {
+	int r;
+	int fd;
+	int ifd;
+	int root_wd;
+	int *wd;
+	int *e;
+	int saved;
+	bool resolving;
+	size_t i;
+	size_t pending;
+	int64_t deadline;
+	int64_t remaining;
+	struct pollfd pollfd;
+	char buf[ 4096 ] __attribute__(( aligned( __alignof__( struct inotify_event ) ) ));
+	char *p;
+	const struct inotify_event *ev;
+	char sys_class_gpio_export[ PATH_MAX ];
+	char num[ 16 ];
+
+	GPIO_TRACE_BEGIN( t );
+
+	deadline = gpio_export_now_ms() + timeout_ms;
+	ifd = -1;
+	resolving = false;
+
+	wd = calloc( 2 * n + 1, sizeof( *wd ) );
+	if ( NULL == wd ) {
+		for( i = 0; NULL != err && i < n; i++ ) {
+			err[ i ] = ENOMEM;
+		}
+		errno = ENOMEM;
+		r = -1;
+		goto out;
+	}
+	e = NULL == err ? wd + n : err;
+	for( i = 0; i < n; i++ ) {
+		wd[ i ] = -1;
+		e[ i ] = EXIT_SUCCESS;
+	}
+
+	r = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+	if ( -1 == r ) {
+		goto fail;
+	}
+	ifd = r;
+
+	// sysfs creates gpioN synchronously, but a simulated (or slow) tree may not
+	root_wd = inotify_add_watch( ifd, gpio_sysfs_root, IN_CREATE | IN_MOVED_TO );
+
+	memset( sys_class_gpio_export, 0, sizeof( sys_class_gpio_export ) );
+	snprintf( sys_class_gpio_export, sizeof( sys_class_gpio_export ) - 1, "%s/export", gpio_sysfs_root );
+
+	r = open( sys_class_gpio_export, O_WRONLY );
+	if ( -1 == r ) {
+		goto fail;
+	}
+	fd = r;
+
+	// issue every export before waiting on any of them
+	for( i = 0; i < n; i++ ) {
+		if ( gpio_is_exported( gpio[ i ] ) ) {
+			continue;
+		}
+		memset( num, 0, sizeof( num ) );
+		snprintf( num, sizeof( num ) - 1, "%u", gpio[ i ] );
+		if ( -1 == write( fd, num, strlen( num ) ) ) {
+			e[ i ] = errno;
+		}
+	}
+
+	close( fd );
+
+	// watch before checking, so that no permission change can slip between
+	pending = 0;
+	for( i = 0; i < n; i++ ) {
+		if ( EXIT_SUCCESS != e[ i ] ) {
+			continue;
+		}
+		wd[ i ] = gpio_export_watch( ifd, gpio[ i ] );
+		if ( EXIT_SUCCESS == gpio_export_ready( gpio[ i ] ) ) {
+			continue;
+		}
+		e[ i ] = ETIMEDOUT;
+		pending++;
+	}
+	resolving = true;
+
+	pollfd.fd = ifd;
+	pollfd.events = POLLIN;
+
+	while( pending > 0 ) {
+
+		remaining = deadline - gpio_export_now_ms();
+		if ( timeout_ms >= 0 && remaining <= 0 ) {
+			break;
+		}
+
+		r = poll( & pollfd, 1, timeout_ms < 0 ? -1 : (int) remaining );
+		if ( -1 == r ) {
+			if ( EINTR == errno ) {
+				continue;
+			}
+			goto fail;
+		}
+		if ( 0 == r ) {
+			break;
+		}
+
+		r = read( ifd, buf, sizeof( buf ) );
+		if ( -1 == r ) {
+			if ( EAGAIN == errno || EINTR == errno ) {
+				continue;
+			}
+			goto fail;
+		}
+
+		for( p = buf; p < buf + r; p += sizeof( *ev ) + ev->len ) {
+			ev = (const struct inotify_event *) p;
+			for( i = 0; i < n; i++ ) {
+				if ( ETIMEDOUT != e[ i ] ) {
+					continue;
+				}
+				if ( ev->mask & IN_Q_OVERFLOW ) {
+					// events were lost, so re-check everything
+				} else if ( -1 != root_wd && ev->wd == root_wd && -1 == wd[ i ] ) {
+					wd[ i ] = gpio_export_watch( ifd, gpio[ i ] );
+				} else if ( ev->wd != wd[ i ] ) {
+					continue;
+				}
+				if ( EXIT_SUCCESS == gpio_export_ready( gpio[ i ] ) ) {
+					e[ i ] = EXIT_SUCCESS;
+					pending--;
+				}
+			}
+		}
+	}
+
+	r = EXIT_SUCCESS;
+	for( i = 0; i < n; i++ ) {
+		if ( EXIT_SUCCESS != e[ i ] ) {
+			errno = e[ i ];
+			r = -1;
+			break;
+		}
+	}
+
+	goto closeifd;
+
+fail:
+	// the whole call failed, so every pin not yet resolved failed with it
+	saved = errno;
+	for( i = 0; i < n; i++ ) {
+		if ( ETIMEDOUT == e[ i ] || ( ! resolving && EXIT_SUCCESS == e[ i ] ) ) {
+			e[ i ] = saved;
+		}
+	}
+	errno = saved;
+	r = -1;
+
+closeifd:
+	if ( -1 != ifd ) {
+		close( ifd );
+	}
+
+	free( wd );
+
+out:
+	GPIO_TRACE_END( t, GPIO_TRACE_OP_EXPORT_BULK, 1 == n ? gpio[ 0 ] : GPIO_TRACE_GPIO_NONE, n, timeout_ms, r );
+	return r;
+}
+int gpio_export_wait( uint16_t gpio, int timeout_ms ) {
+	return gpio_export_bulk( & gpio, 1, timeout_ms, NULL );
+}
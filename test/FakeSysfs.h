@@ -0,0 +1,173 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef com_github_cfriedt_FakeSysfs_h_
+#define com_github_cfriedt_FakeSysfs_h_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <sched.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <system_error>
+
+#include "libgpio/libgpio.h"
+
+namespace com {
+namespace github {
+namespace cfriedt {
+
+/**
+ * @brief A throw-away directory that mimics /sys/class/gpio
+ *
+ * Files are plain files, so writes stick and reads return whatever was last
+ * written, but nothing is created by writing to export and POLLPRI is never
+ * raised, unless a value file is made pollable(). libgpio is pointed at the
+ * directory for the lifetime of the object.
+ */
+class FakeSysfs {
+
+public:
+	FakeSysfs() {
+		char tmpl[] = "/tmp/libgpio-sysfs-XXXXXX";
+		if ( NULL == mkdtemp( tmpl ) ) {
+			throw std::system_error( errno, std::system_category() );
+		}
+		dir = tmpl;
+		file( "export", "" );
+		file( "unexport", "" );
+		gpio_sysfs_root_set( dir.c_str() );
+	}
+	virtual ~FakeSysfs() {
+		gpio_sysfs_root_set( NULL );
+		nftw( dir.c_str(), remove_, 16, FTW_DEPTH | FTW_PHYS );
+	}
+
+	const std::string &root() {
+		return dir;
+	}
+
+	std::string path( const std::string &rel ) {
+		return dir + "/" + rel;
+	}
+
+	void mkdir( const std::string &rel ) {
+		if ( -1 == ::mkdir( path( rel ).c_str(), 0755 ) && EEXIST != errno ) {
+			throw std::system_error( errno, std::system_category() );
+		}
+	}
+
+	void file( const std::string &rel, const std::string &contents ) {
+		FILE *f = fopen( path( rel ).c_str(), "w" );
+		if ( NULL == f ) {
+			throw std::system_error( errno, std::system_category() );
+		}
+		fputs( contents.c_str(), f );
+		fclose( f );
+	}
+
+	std::string read( const std::string &rel ) {
+		std::string r;
+		char buf[ 64 ];
+		size_t n;
+		FILE *f = fopen( path( rel ).c_str(), "r" );
+		if ( NULL == f ) {
+			throw std::system_error( errno, std::system_category() );
+		}
+		while( ( n = fread( buf, 1, sizeof( buf ), f ) ) > 0 ) {
+			r.append( buf, n );
+		}
+		fclose( f );
+		return r;
+	}
+
+	void chip( unsigned base, unsigned ngpio, const std::string &label ) {
+		std::string name = "gpiochip" + std::to_string( base );
+		mkdir( name );
+		file( name + "/base", std::to_string( base ) + "\n" );
+		file( name + "/ngpio", std::to_string( ngpio ) + "\n" );
+		file( name + "/label", label + "\n" );
+	}
+
+	void gpio( unsigned num, const std::string &direction = "in", const std::string &value = "0", const std::string &edge = "none" ) {
+		std::string name = "gpio" + std::to_string( num );
+		mkdir( name );
+		file( name + "/direction", direction + "\n" );
+		file( name + "/value", value + "\n" );
+		file( name + "/edge", edge + "\n" );
+	}
+
+	/**
+	 * @brief Make edges on one GPIO raise POLLPRI, as real ones do
+	 *
+	 * The value file is replaced by a link to /proc/sys/kernel/hostname in a
+	 * private UTS namespace of the calling thread (and of threads it starts
+	 * afterwards), which the kernel notifies on every level(). Needs
+	 * CAP_SYS_ADMIN, and only one GPIO can be pollable at a time. The
+	 * notification is not per namespace, so tests running in parallel may
+	 * see spurious edges, at an unchanged level.
+	 *
+	 * @return false if no private UTS namespace is available
+	 */
+	bool pollable( unsigned num ) {
+		std::string value = path( "gpio" + std::to_string( num ) + "/value" );
+		if ( -1 == unshare( CLONE_NEWUTS ) ) {
+			return false;
+		}
+		level( "0" );
+		if ( -1 == ::remove( value.c_str() ) || -1 == symlink( "/proc/sys/kernel/hostname", value.c_str() ) ) {
+			throw std::system_error( errno, std::system_category() );
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Drive the pollable() GPIO to a level, e.g. "1"
+	 */
+	void level( const std::string &value ) {
+		if ( -1 == sethostname( value.c_str(), value.size() ) ) {
+			throw std::system_error( errno, std::system_category() );
+		}
+	}
+
+protected:
+	std::string dir;
+
+	static int remove_( const char *fpath, const struct stat *sb, int typeflag, struct FTW *ftwbuf ) {
+		(void) sb;
+		(void) typeflag;
+		(void) ftwbuf;
+		return ::remove( fpath );
+	}
+};
+
+}
+}
+} // com.github.cfriedt
+
+#endif // com_github_cfriedt_FakeSysfs_h_
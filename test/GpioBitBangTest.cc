@@ -0,0 +1,140 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <errno.h>
+
+#include <gtest/gtest.h>
+
+#include "libgpio/GpioBitBang.h"
+
+#include "FakeSysfs.h"
+
+using namespace ::std;
+using namespace ::com::github::cfriedt;
+
+class GpioBitBangTest : public testing::Test
+{
+
+public:
+
+	FakeSysfs sysfs;
+
+	void SetUp();
+	void TearDown();
+
+	char level( unsigned num ) {
+		return sysfs.read( "gpio" + std::to_string( num ) + "/value" )[ 0 ];
+	}
+	std::string direction( unsigned num ) {
+		return sysfs.read( "gpio" + std::to_string( num ) + "/direction" ).substr( 0, 2 );
+	}
+};
+
+void GpioBitBangTest::SetUp() {
+	for( unsigned num = 40; num < 44; num++ ) {
+		sysfs.gpio( num );
+	}
+}
+
+void GpioBitBangTest::TearDown() {
+}
+
+TEST_F( GpioBitBangTest, TestSpiMode0 ) {
+	GpioSpi spi( 40, 41, 42, 43, 0 );
+	uint8_t tx[] = { 0xa5, 0x01 };
+	uint8_t rx[] = { 0x00, 0x00 };
+
+	sysfs.file( "gpio42/value", "1\n" );
+	spi.transfer( tx, rx, sizeof( tx ) );
+
+	EXPECT_EQ( 0xff, rx[ 0 ] );
+	EXPECT_EQ( 0xff, rx[ 1 ] );
+	EXPECT_EQ( '0', level( 40 ) );
+	EXPECT_EQ( '1', level( 41 ) );
+	EXPECT_EQ( '1', level( 43 ) );
+	EXPECT_GT( spi.bits_per_second(), 0 );
+
+	// 16 samples, 32 clock edges, 9 changes of MOSI, 2 of CS
+	EXPECT_EQ( 16U + 32U + 9U + 2U, spi.steps() );
+}
+
+TEST_F( GpioBitBangTest, TestSpiMode3 ) {
+	GpioSpi spi( 40, 41, 42, GpioSpi::NONE, 3 );
+	uint8_t tx[] = { 0x80 };
+	uint8_t rx[] = { 0xff };
+
+	EXPECT_EQ( '1', level( 40 ) );
+
+	spi.transfer( tx, rx, sizeof( tx ) );
+
+	EXPECT_EQ( 0x00, rx[ 0 ] );
+	EXPECT_EQ( '1', level( 40 ) );
+	EXPECT_EQ( '0', level( 41 ) );
+}
+
+TEST_F( GpioBitBangTest, TestI2cAck ) {
+	GpioI2c i2c( 40, 41 );
+	uint8_t data[] = { 0x12, 0x34 };
+
+	// nothing releases SDA in a simulated tree, so every acknowledge is seen as low
+	sysfs.file( "gpio41/value", "0\n" );
+	i2c.write( 0x50, data, sizeof( data ) );
+
+	EXPECT_EQ( "in", direction( 40 ) );
+	EXPECT_EQ( "in", direction( 41 ) );
+
+	i2c.read( 0x50, data, sizeof( data ) );
+	EXPECT_EQ( 0x00, data[ 0 ] );
+	EXPECT_EQ( 0x00, data[ 1 ] );
+}
+
+TEST_F( GpioBitBangTest, TestI2cNack ) {
+	GpioI2c i2c( 40, 41 );
+	uint8_t data[] = { 0x12 };
+	int actual_errno;
+
+	sysfs.file( "gpio41/value", "1\n" );
+
+	actual_errno = EXIT_SUCCESS;
+	try {
+		i2c.write( 0x50, data, sizeof( data ) );
+	} catch( std::system_error &e ) {
+		actual_errno = e.code().value();
+	}
+	EXPECT_EQ( ENXIO, actual_errno );
+}
+
+TEST_F( GpioBitBangTest, TestShiftRegister ) {
+	GpioShiftRegister sr( 40, 41, 42 );
+	uint8_t data[] = { 0x01 };
+
+	sr.shift( data, sizeof( data ) );
+
+	EXPECT_EQ( '1', level( 40 ) );
+	EXPECT_EQ( '0', level( 41 ) );
+	EXPECT_EQ( '0', level( 42 ) );
+
+	// 16 clock edges, 1 change of data, 2 latch edges
+	EXPECT_EQ( 16U + 1U + 2U, sr.steps() );
+}
@@ -0,0 +1,279 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "libgpio/GpioBroker.h"
+
+#include "FakeSysfs.h"
+
+using namespace ::std;
+using namespace ::com::github::cfriedt;
+
+class GpioBrokerTest : public testing::Test
+{
+
+public:
+
+	FakeSysfs sysfs;
+	std::string shm_name;
+	std::string socket_path;
+	std::unique_ptr<GpioBroker> broker;
+	std::thread thread;
+
+	void SetUp();
+	void TearDown();
+};
+
+void GpioBrokerTest::SetUp() {
+	sysfs.gpio( 10, "in", "1" );
+	sysfs.gpio( 11, "out", "0" );
+
+	shm_name = "/libgpio-broker-test-" + std::to_string( getpid() );
+	socket_path = sysfs.path( "broker.sock" );
+
+	broker.reset( new GpioBroker( shm_name, socket_path ) );
+	broker->add( 10, GPIO_DIR_IN );
+	broker->add( 11, GPIO_DIR_OUT );
+	broker->start();
+
+	thread = std::thread( [ this ]() {
+		broker->run();
+	} );
+}
+
+void GpioBrokerTest::TearDown() {
+	broker->interrupt();
+	thread.join();
+	broker.reset();
+}
+
+TEST_F( GpioBrokerTest, TestState ) {
+	GpioBrokerClient client( shm_name, socket_path );
+	GpioBrokerState state;
+	std::vector<uint16_t> expected_nums = { 10, 11 };
+
+	EXPECT_EQ( expected_nums, client.nums() );
+	EXPECT_EQ( GPIO_VALUE_HIGH, client.value( 10 ) );
+	EXPECT_EQ( GPIO_VALUE_LOW, client.value( 11 ) );
+
+	state = client.state( 10 );
+	EXPECT_EQ( GPIO_DIR_IN, state.direction );
+	EXPECT_EQ( 0, state.owner );
+	EXPECT_NE( 0U, state.timestamp_ns );
+
+	EXPECT_EQ( "both", sysfs.read( "gpio10/edge" ).substr( 0, 4 ) );
+}
+
+TEST_F( GpioBrokerTest, TestArbitration ) {
+	GpioBrokerClient a( shm_name, socket_path );
+	GpioBrokerClient b( shm_name, socket_path );
+	int actual_errno;
+
+	a.value( 11, GPIO_VALUE_HIGH );
+	EXPECT_EQ( '1', sysfs.read( "gpio11/value" )[ 0 ] );
+	EXPECT_EQ( GPIO_VALUE_HIGH, b.value( 11 ) );
+	EXPECT_EQ( getpid(), b.state( 11 ).owner );
+
+	actual_errno = EXIT_SUCCESS;
+	try {
+		b.value( 11, GPIO_VALUE_LOW );
+	} catch( std::system_error &e ) {
+		actual_errno = e.code().value();
+	}
+	EXPECT_EQ( EBUSY, actual_errno );
+	EXPECT_EQ( '1', sysfs.read( "gpio11/value" )[ 0 ] );
+
+	actual_errno = EXIT_SUCCESS;
+	try {
+		b.value( 10, GPIO_VALUE_LOW );
+	} catch( std::system_error &e ) {
+		actual_errno = e.code().value();
+	}
+	EXPECT_EQ( EINVAL, actual_errno );
+
+	a.release( 11 );
+	EXPECT_EQ( 0, b.state( 11 ).owner );
+	b.value( 11, GPIO_VALUE_LOW );
+	EXPECT_EQ( '0', sysfs.read( "gpio11/value" )[ 0 ] );
+}
+
+TEST_F( GpioBrokerTest, TestDisconnectReleases ) {
+	std::unique_ptr<GpioBrokerClient> a( new GpioBrokerClient( shm_name, socket_path ) );
+	GpioBrokerClient b( shm_name, socket_path );
+
+	a->claim( 11 );
+	a.reset();
+
+	for( int i = 0; 0 != b.state( 11 ).owner && i < 1000; i++ ) {
+		std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+	}
+	b.claim( 11 );
+}
+
+TEST_F( GpioBrokerTest, TestWaitEdge ) {
+	GpioBrokerClient a( shm_name, socket_path );
+	GpioBrokerClient b( shm_name, socket_path );
+	uint32_t seen;
+	uint32_t actual;
+	int actual_errno;
+
+	seen = b.edges( 11 );
+
+	actual_errno = EXIT_SUCCESS;
+	try {
+		b.wait( 11, seen, 10 );
+	} catch( std::system_error &e ) {
+		actual_errno = e.code().value();
+	}
+	EXPECT_EQ( ETIMEDOUT, actual_errno );
+
+	std::thread writer( [ & a ]() {
+		std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+		a.value( 11, GPIO_VALUE_HIGH );
+	} );
+	actual = b.wait( 11, seen, 5000 );
+	writer.join();
+
+	EXPECT_EQ( seen + 1, actual );
+	EXPECT_EQ( GPIO_VALUE_HIGH, b.value( 11 ) );
+}
+
+TEST_F( GpioBrokerTest, TestSecondBrokerRefused ) {
+	GpioBroker other( shm_name, sysfs.path( "other.sock" ) );
+	GpioBrokerClient client( shm_name, socket_path );
+	std::vector<std::string> files = { "gpio10/direction", "gpio10/edge", "gpio11/direction", "gpio11/value" };
+	std::vector<std::string> contents;
+	std::vector<struct timespec> mtimes;
+	struct stat st;
+	int actual_errno;
+
+	client.value( 11, GPIO_VALUE_HIGH );
+	for( auto & f: files ) {
+		ASSERT_EQ( 0, stat( sysfs.path( f ).c_str(), & st ) );
+		contents.push_back( sysfs.read( f ) );
+		mtimes.push_back( st.st_mtim );
+	}
+
+	other.add( 10, GPIO_DIR_IN );
+	other.add( 11, GPIO_DIR_OUT );
+
+	actual_errno = EXIT_SUCCESS;
+	try {
+		other.start();
+	} catch( std::system_error &e ) {
+		actual_errno = e.code().value();
+	}
+	EXPECT_EQ( EEXIST, actual_errno );
+
+	// the GPIOs of the first broker were not even written to
+	for( size_t i = 0; i < files.size(); i++ ) {
+		ASSERT_EQ( 0, stat( sysfs.path( files[ i ] ).c_str(), & st ) );
+		EXPECT_EQ( contents[ i ], sysfs.read( files[ i ] ) ) << files[ i ];
+		EXPECT_EQ( mtimes[ i ].tv_sec, st.st_mtim.tv_sec ) << files[ i ];
+		EXPECT_EQ( mtimes[ i ].tv_nsec, st.st_mtim.tv_nsec ) << files[ i ];
+	}
+	EXPECT_EQ( '1', sysfs.read( "gpio11/value" )[ 0 ] );
+	EXPECT_EQ( GPIO_VALUE_HIGH, client.value( 10 ) );
+	EXPECT_EQ( GPIO_VALUE_HIGH, client.value( 11 ) );
+}
+
+TEST_F( GpioBrokerTest, TestStaleSegmentReclaimed ) {
+	std::string stale_name = shm_name + "-stale";
+	pid_t pid;
+	int fd;
+	GpioBrokerShm *shm;
+
+	// a pid that is certainly no longer running
+	pid = fork();
+	ASSERT_NE( -1, pid );
+	if ( 0 == pid ) {
+		_exit( EXIT_SUCCESS );
+	}
+	waitpid( pid, NULL, 0 );
+
+	fd = shm_open( stale_name.c_str(), O_CREAT | O_RDWR, 0644 );
+	ASSERT_NE( -1, fd );
+	ASSERT_EQ( 0, ftruncate( fd, sizeof( GpioBrokerShm ) ) );
+	shm = (GpioBrokerShm *) mmap( NULL, sizeof( GpioBrokerShm ), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+	close( fd );
+	ASSERT_NE( MAP_FAILED, (void *) shm );
+	shm->magic = GPIO_BROKER_MAGIC;
+	shm->pid = pid;
+	munmap( shm, sizeof( GpioBrokerShm ) );
+
+	GpioBroker other( stale_name, sysfs.path( "other.sock" ) );
+	other.add( 10, GPIO_DIR_IN );
+	other.start();
+
+	GpioBrokerClient client( stale_name, sysfs.path( "other.sock" ) );
+	EXPECT_EQ( GPIO_VALUE_HIGH, client.value( 10 ) );
+}
+
+TEST_F( GpioBrokerTest, TestEdgesCountNotifications ) {
+	std::string other_name = shm_name + "-poll";
+	std::string other_path = sysfs.path( "poll.sock" );
+	std::unique_ptr<GpioBroker> other;
+	std::thread runner;
+	uint32_t seen;
+
+	sysfs.gpio( 12 );
+	if ( ! sysfs.pollable( 12 ) ) {
+		GTEST_SKIP();
+	}
+
+	other.reset( new GpioBroker( other_name, other_path ) );
+	other->add( 12, GPIO_DIR_IN );
+	other->start();
+	runner = std::thread( [ & other ]() {
+		other->run();
+	} );
+
+	GpioBrokerClient client( other_name, other_path );
+
+	seen = client.edges( 12 );
+	sysfs.level( "1" );
+	seen = client.wait( 12, seen, 1000 );
+	EXPECT_EQ( GPIO_VALUE_HIGH, client.value( 12 ) );
+
+	// a pulse that was over before the broker read the level is still an edge
+	sysfs.level( "1" );
+	EXPECT_LT( seen, client.wait( 12, seen, 1000 ) );
+	EXPECT_EQ( GPIO_VALUE_HIGH, client.value( 12 ) );
+
+	other->interrupt();
+	runner.join();
+}
@@ -0,0 +1,200 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <chrono>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "libgpio/gpiochip.h"
+
+#include "FakeSysfs.h"
+
+using namespace ::std;
+using namespace ::com::github::cfriedt;
+
+class GpioChipTest : public testing::Test
+{
+
+public:
+
+	FakeSysfs sysfs;
+
+	void SetUp();
+	void TearDown();
+};
+
+void GpioChipTest::SetUp() {
+	sysfs.chip( 480, 32, "pcal6524" );
+	sysfs.chip( 0, 32, "gpio-bank0" );
+	sysfs.chip( 32, 16, "gpio-bank1" );
+	ASSERT_EQ( 3, gpio_chip_refresh() );
+}
+
+void GpioChipTest::TearDown() {
+}
+
+TEST_F( GpioChipTest, TestOrderedByBase ) {
+	gpio_chip_t chip;
+
+	EXPECT_EQ( 3, gpio_chip_count() );
+
+	ASSERT_EQ( EXIT_SUCCESS, gpio_chip_get( 0, & chip ) );
+	EXPECT_STREQ( "gpiochip0", chip.name );
+	ASSERT_EQ( EXIT_SUCCESS, gpio_chip_get( 2, & chip ) );
+	EXPECT_STREQ( "pcal6524", chip.label );
+
+	errno = 0;
+	EXPECT_EQ( -1, gpio_chip_get( 3, & chip ) );
+	EXPECT_EQ( ERANGE, errno );
+}
+
+TEST_F( GpioChipTest, TestFindLabel ) {
+	gpio_chip_t chip;
+
+	ASSERT_EQ( EXIT_SUCCESS, gpio_chip_find( "gpio-bank1", & chip ) );
+	EXPECT_EQ( 32, chip.base );
+	EXPECT_EQ( 16, chip.ngpio );
+
+	errno = 0;
+	EXPECT_EQ( -1, gpio_chip_find( "gpio-bank2", & chip ) );
+	EXPECT_EQ( ENOENT, errno );
+}
+
+TEST_F( GpioChipTest, TestFindGpio ) {
+	gpio_chip_t chip;
+	uint16_t offset;
+
+	ASSERT_EQ( EXIT_SUCCESS, gpio_chip_find_gpio( 485, & chip, & offset ) );
+	EXPECT_STREQ( "pcal6524", chip.label );
+	EXPECT_EQ( 5, offset );
+
+	ASSERT_EQ( EXIT_SUCCESS, gpio_chip_find_gpio( 47, NULL, & offset ) );
+	EXPECT_EQ( 15, offset );
+
+	errno = 0;
+	EXPECT_EQ( -1, gpio_chip_find_gpio( 48, & chip, & offset ) );
+	EXPECT_EQ( ENOENT, errno );
+	errno = 0;
+	EXPECT_EQ( -1, gpio_chip_find_gpio( 512, & chip, & offset ) );
+	EXPECT_EQ( ENOENT, errno );
+}
+
+TEST_F( GpioChipTest, TestLabelOffset ) {
+	uint16_t gpio;
+
+	ASSERT_EQ( EXIT_SUCCESS, gpio_chip_gpio( "pcal6524", 3, & gpio ) );
+	EXPECT_EQ( 483, gpio );
+
+	errno = 0;
+	EXPECT_EQ( -1, gpio_chip_gpio( "gpio-bank1", 16, & gpio ) );
+	EXPECT_EQ( ERANGE, errno );
+}
+
+TEST_F( GpioChipTest, TestRefresh ) {
+	uint16_t gpio;
+
+	sysfs.chip( 64, 8, "hotplugged" );
+
+	errno = 0;
+	EXPECT_EQ( -1, gpio_chip_gpio( "hotplugged", 0, & gpio ) );
+	EXPECT_EQ( ENOENT, errno );
+
+	ASSERT_EQ( 4, gpio_chip_refresh() );
+	ASSERT_EQ( EXIT_SUCCESS, gpio_chip_gpio( "hotplugged", 7, & gpio ) );
+	EXPECT_EQ( 71, gpio );
+}
+
+TEST_F( GpioChipTest, TestUnreadableChipSkipped ) {
+	gpio_chip_t chip;
+
+	sysfs.chip( 64, 8, "broken" );
+	ASSERT_EQ( 0, unlink( sysfs.path( "gpiochip64/label" ).c_str() ) );
+
+	ASSERT_EQ( 3, gpio_chip_refresh() );
+	ASSERT_EQ( EXIT_SUCCESS, gpio_chip_find( "gpio-bank1", & chip ) );
+	errno = 0;
+	EXPECT_EQ( -1, gpio_chip_find_gpio( 64, & chip, NULL ) );
+	EXPECT_EQ( ENOENT, errno );
+}
+
+TEST_F( GpioChipTest, TestRootChangeInvalidates ) {
+	gpio_chip_t chip;
+
+	ASSERT_EQ( EXIT_SUCCESS, gpio_chip_find( "pcal6524", & chip ) );
+	{
+		FakeSysfs other;
+		other.chip( 100, 4, "other" );
+
+		ASSERT_EQ( EXIT_SUCCESS, gpio_chip_find( "other", & chip ) );
+		EXPECT_EQ( 100, chip.base );
+		errno = 0;
+		EXPECT_EQ( -1, gpio_chip_find( "pcal6524", & chip ) );
+		EXPECT_EQ( ENOENT, errno );
+	}
+	ASSERT_EQ( EXIT_SUCCESS, gpio_sysfs_root_set( sysfs.root().c_str() ) );
+	ASSERT_EQ( EXIT_SUCCESS, gpio_chip_find( "pcal6524", & chip ) );
+}
+
+TEST_F( GpioChipTest, TestRootChangeDuringRefresh ) {
+	std::string label = sysfs.path( "gpiochip480/label" );
+	std::thread refresher;
+	int r = -1;
+	int fd = -1;
+	gpio_chip_t chip;
+
+	// the scan blocks opening the label until it is written
+	ASSERT_EQ( 0, ::remove( label.c_str() ) );
+	ASSERT_EQ( 0, mkfifo( label.c_str(), 0644 ) );
+	refresher = std::thread( [ & r ]() {
+		r = gpio_chip_refresh();
+	} );
+	for( unsigned i = 0; -1 == fd && i < 1000; i++ ) {
+		fd = open( label.c_str(), O_WRONLY | O_NONBLOCK );
+		if ( -1 == fd ) {
+			std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+		}
+	}
+	ASSERT_NE( -1, fd );
+
+	{
+		FakeSysfs other;
+		other.chip( 100, 4, "other" );
+
+		write( fd, "pcal6524\n", 9 );
+		close( fd );
+		refresher.join();
+
+		// the index of the old root must not be installed
+		EXPECT_EQ( 1, r );
+		EXPECT_EQ( 1, gpio_chip_count() );
+		ASSERT_EQ( EXIT_SUCCESS, gpio_chip_find( "other", & chip ) );
+		EXPECT_EQ( 100, chip.base );
+	}
+}
@@ -0,0 +1,435 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <errno.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "libgpio/GpioDispatcher.h"
+
+#include "FakeSysfs.h"
+
+using namespace ::std;
+using namespace ::com::github::cfriedt;
+
+// plain files never raise POLLPRI, so edges are injected directly
+class TestableGpioDispatcher : public GpioDispatcher {
+
+public:
+	void inject( uint16_t num, gpio_value_t value ) {
+		deliver( num, value, std::chrono::steady_clock::now() );
+	}
+};
+
+class GpioDispatcherTest : public testing::Test
+{
+
+public:
+
+	FakeSysfs sysfs;
+	TestableGpioDispatcher dispatcher;
+
+	void SetUp();
+	void TearDown();
+};
+
+void GpioDispatcherTest::SetUp() {
+	sysfs.gpio( 20, "in", "0" );
+	sysfs.gpio( 21, "in", "1" );
+}
+
+void GpioDispatcherTest::TearDown() {
+}
+
+TEST_F( GpioDispatcherTest, TestConfiguresBothEdges ) {
+	dispatcher.subscribe( 20, GPIO_EDGE_RISING, []( const GpioEvent & ) {} );
+	EXPECT_EQ( "both", sysfs.read( "gpio20/edge" ).substr( 0, 4 ) );
+}
+
+TEST_F( GpioDispatcherTest, TestEdgeFilters ) {
+	unsigned rising = 0;
+	unsigned falling = 0;
+	unsigned both = 0;
+
+	dispatcher.subscribe( 20, GPIO_EDGE_RISING, [ & rising ]( const GpioEvent &e ) {
+		EXPECT_EQ( GPIO_EDGE_RISING, e.edge );
+		rising++;
+	} );
+	dispatcher.subscribe( 20, GPIO_EDGE_FALLING, [ & falling ]( const GpioEvent &e ) {
+		EXPECT_EQ( GPIO_EDGE_FALLING, e.edge );
+		falling++;
+	} );
+	dispatcher.subscribe( 20, GPIO_EDGE_BOTH, [ & both ]( const GpioEvent &e ) {
+		EXPECT_EQ( 20, e.num );
+		both++;
+	} );
+
+	dispatcher.inject( 20, GPIO_VALUE_HIGH );
+	dispatcher.inject( 20, GPIO_VALUE_HIGH );
+	dispatcher.inject( 20, GPIO_VALUE_LOW );
+	dispatcher.inject( 20, GPIO_VALUE_HIGH );
+	dispatcher.inject( 21, GPIO_VALUE_LOW );
+
+	EXPECT_EQ( 2U, rising );
+	EXPECT_EQ( 1U, falling );
+	EXPECT_EQ( 3U, both );
+}
+
+TEST_F( GpioDispatcherTest, TestQueue ) {
+	GpioEventQueue queue( 2 );
+	GpioEvent event;
+
+	dispatcher.subscribe( 21, GPIO_EDGE_BOTH, queue );
+
+	EXPECT_FALSE( queue.pop( event, 0 ) );
+
+	dispatcher.inject( 21, GPIO_VALUE_LOW );
+	dispatcher.inject( 21, GPIO_VALUE_HIGH );
+	dispatcher.inject( 21, GPIO_VALUE_LOW );
+
+	EXPECT_EQ( 2U, queue.size() );
+	EXPECT_EQ( 1U, queue.dropped() );
+	ASSERT_TRUE( queue.pop( event, 0 ) );
+	EXPECT_EQ( GPIO_EDGE_RISING, event.edge );
+	ASSERT_TRUE( queue.pop( event, 0 ) );
+	EXPECT_EQ( GPIO_VALUE_LOW, event.value );
+}
+
+TEST_F( GpioDispatcherTest, TestUnsubscribe ) {
+	unsigned a = 0;
+	unsigned b = 0;
+	GpioDispatcher::Subscription sa;
+	GpioDispatcher::Subscription sb;
+
+	sa = dispatcher.subscribe( 20, GPIO_EDGE_BOTH, [ & a ]( const GpioEvent & ) { a++; } );
+	sb = dispatcher.subscribe( 20, GPIO_EDGE_BOTH, [ & b ]( const GpioEvent & ) { b++; } );
+
+	dispatcher.inject( 20, GPIO_VALUE_HIGH );
+	dispatcher.unsubscribe( sa );
+	dispatcher.inject( 20, GPIO_VALUE_LOW );
+	dispatcher.unsubscribe( sb );
+	dispatcher.inject( 20, GPIO_VALUE_HIGH );
+
+	EXPECT_EQ( 1U, a );
+	EXPECT_EQ( 2U, b );
+}
+
+TEST_F( GpioDispatcherTest, TestInvalidEdge ) {
+	int actual_errno = EXIT_SUCCESS;
+	try {
+		dispatcher.subscribe( 20, GPIO_EDGE_NONE, []( const GpioEvent & ) {} );
+	} catch( std::system_error &e ) {
+		actual_errno = e.code().value();
+	}
+	EXPECT_EQ( EINVAL, actual_errno );
+}
+
+TEST_F( GpioDispatcherTest, TestStormCoalesces ) {
+	GpioEventQueue queue( 1024 );
+	GpioEvent event;
+	std::mutex m;
+	std::vector<bool> transitions;
+	GpioStormGuard::Counters counters;
+
+	dispatcher.storm( GpioStormGuard::Config( 10, std::chrono::milliseconds( 1000 ), std::chrono::milliseconds( 20 ) ) );
+	dispatcher.on_storm( [ & m, & transitions ]( uint16_t num, bool storming, const GpioStormGuard::Counters & ) {
+		std::lock_guard<std::mutex> guard( m );
+		EXPECT_EQ( 20, num );
+		transitions.push_back( storming );
+	} );
+	dispatcher.subscribe( 20, GPIO_EDGE_BOTH, queue );
+
+	for( unsigned i = 0; i < 100; i++ ) {
+		dispatcher.inject( 20, 0 == i % 2 ? GPIO_VALUE_HIGH : GPIO_VALUE_LOW );
+	}
+
+	// 11 edges delivered one by one, the rest in one aggregated event
+	for( unsigned i = 0; i < 11; i++ ) {
+		ASSERT_TRUE( queue.pop( event, 1000 ) );
+		EXPECT_EQ( 1U, event.count );
+	}
+	ASSERT_TRUE( queue.pop( event, 1000 ) );
+	EXPECT_EQ( GPIO_EDGE_BOTH, event.edge );
+	EXPECT_EQ( 89U, event.count );
+
+	// the storm ends after one quiet interval
+	for( unsigned i = 0; i < 1000; i++ ) {
+		{
+			std::lock_guard<std::mutex> guard( m );
+			if ( 2 == transitions.size() ) {
+				break;
+			}
+		}
+		std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+	}
+
+	counters = dispatcher.storm_counters( 20 );
+	EXPECT_EQ( 100U, counters.edges );
+	EXPECT_EQ( 89U, counters.coalesced );
+	EXPECT_EQ( 1U, counters.storms );
+
+	std::lock_guard<std::mutex> guard( m );
+	ASSERT_EQ( 2U, transitions.size() );
+	EXPECT_TRUE( transitions[ 0 ] );
+	EXPECT_FALSE( transitions[ 1 ] );
+}
+
+TEST_F( GpioDispatcherTest, TestPollDelivers ) {
+	GpioEventQueue queue;
+	GpioEvent event;
+
+	sysfs.gpio( 22 );
+	if ( ! sysfs.pollable( 22 ) ) {
+		GTEST_SKIP();
+	}
+
+	dispatcher.subscribe( 22, GPIO_EDGE_BOTH, queue );
+
+	sysfs.level( "1" );
+	ASSERT_TRUE( queue.pop( event, 1000 ) );
+	EXPECT_EQ( GPIO_EDGE_RISING, event.edge );
+	EXPECT_EQ( GPIO_VALUE_HIGH, event.value );
+
+	sysfs.level( "0" );
+	ASSERT_TRUE( queue.pop( event, 1000 ) );
+	EXPECT_EQ( GPIO_EDGE_FALLING, event.edge );
+}
+
+TEST_F( GpioDispatcherTest, TestUnsubscribeWaitsForDelivery ) {
+	std::mutex m;
+	std::condition_variable cv;
+	bool entered = false;
+	std::shared_ptr<bool> done = std::make_shared<bool>( false );
+	GpioDispatcher::Subscription s;
+
+	sysfs.gpio( 22 );
+	if ( ! sysfs.pollable( 22 ) ) {
+		GTEST_SKIP();
+	}
+
+	s = dispatcher.subscribe( 22, GPIO_EDGE_BOTH, [ & m, & cv, & entered, done ]( const GpioEvent & ) {
+		{
+			std::lock_guard<std::mutex> guard( m );
+			entered = true;
+		}
+		cv.notify_one();
+		std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+		*done = true;
+	} );
+
+	sysfs.level( "1" );
+	{
+		std::unique_lock<std::mutex> guard( m );
+		ASSERT_TRUE( cv.wait_for( guard, std::chrono::seconds( 1 ), [ & entered ]() { return entered; } ) );
+	}
+
+	dispatcher.unsubscribe( s );
+	EXPECT_TRUE( *done );
+}
+
+TEST_F( GpioDispatcherTest, TestUnsubscribeFromCallback ) {
+	GpioEventQueue queue;
+	GpioEvent event;
+	unsigned n = 0;
+	GpioDispatcher::Subscription s;
+
+	sysfs.gpio( 22 );
+	if ( ! sysfs.pollable( 22 ) ) {
+		GTEST_SKIP();
+	}
+
+	s = dispatcher.subscribe( 22, GPIO_EDGE_BOTH, [ this, & n, & s ]( const GpioEvent & ) {
+		n++;
+		dispatcher.unsubscribe( s );
+	} );
+	dispatcher.subscribe( 22, GPIO_EDGE_BOTH, queue );
+
+	sysfs.level( "1" );
+	ASSERT_TRUE( queue.pop( event, 1000 ) );
+	sysfs.level( "0" );
+	ASSERT_TRUE( queue.pop( event, 1000 ) );
+
+	EXPECT_EQ( 1U, n );
+}
+
+TEST_F( GpioDispatcherTest, TestDestroyFromCallback ) {
+	GpioDispatcher *d = new GpioDispatcher();
+	std::mutex m;
+	std::condition_variable cv;
+	bool destroyed = false;
+
+	sysfs.gpio( 22 );
+	if ( ! sysfs.pollable( 22 ) ) {
+		delete d;
+		GTEST_SKIP();
+	}
+
+	d->subscribe( 22, GPIO_EDGE_BOTH, [ & d, & m, & cv, & destroyed ]( const GpioEvent & ) {
+		delete d;
+		{
+			std::lock_guard<std::mutex> guard( m );
+			destroyed = true;
+		}
+		cv.notify_one();
+	} );
+
+	sysfs.level( "1" );
+	std::unique_lock<std::mutex> guard( m );
+	EXPECT_TRUE( cv.wait_for( guard, std::chrono::seconds( 1 ), [ & destroyed ]() { return destroyed; } ) );
+}
+
+static void storm_toggle( GpioDispatcher &dispatcher, FakeSysfs &sysfs, bool exact, GpioStormGuard::Counters &counters, uint64_t &coalesced, GpioEvent &last ) {
+	GpioEventQueue queue( 1024 );
+	GpioEvent event;
+	std::mutex m;
+	bool ended = false;
+
+	dispatcher.storm( GpioStormGuard::Config( 5, std::chrono::milliseconds( 1000 ), std::chrono::milliseconds( 100 ), exact ) );
+	dispatcher.on_storm( [ & m, & ended ]( uint16_t, bool storming, const GpioStormGuard::Counters & ) {
+		std::lock_guard<std::mutex> guard( m );
+		ended = ended || ! storming;
+	} );
+	dispatcher.subscribe( 22, GPIO_EDGE_BOTH, queue );
+
+	for( unsigned i = 0; i < 40; i++ ) {
+		sysfs.level( 0 == i % 2 ? "1" : "0" );
+		std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) );
+	}
+
+	// the aggregated event of the last interval precedes the end of the storm
+	for( unsigned i = 0; i < 1000; i++ ) {
+		{
+			std::lock_guard<std::mutex> guard( m );
+			if ( ended ) {
+				break;
+			}
+		}
+		std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+	}
+
+	coalesced = 0;
+	while( queue.pop( event, 0 ) ) {
+		if ( GPIO_EDGE_BOTH == event.edge ) {
+			coalesced += event.count;
+			last = event;
+		}
+	}
+	counters = dispatcher.storm_counters( 22 );
+}
+
+TEST_F( GpioDispatcherTest, TestStormStopsWatching ) {
+	GpioStormGuard::Counters counters;
+	uint64_t coalesced;
+	GpioEvent last = {};
+
+	sysfs.gpio( 22 );
+	if ( ! sysfs.pollable( 22 ) ) {
+		GTEST_SKIP();
+	}
+
+	storm_toggle( dispatcher, sysfs, false, counters, coalesced, last );
+
+	// a GPIO in a storm is only sampled once per interval, so most levels are
+	// never read; tests running in parallel may add notifications, and storms
+	EXPECT_GE( counters.storms, 1U );
+	EXPECT_LT( counters.edges, 20U );
+	EXPECT_GE( coalesced, 1U );
+	EXPECT_EQ( counters.coalesced, coalesced );
+	EXPECT_EQ( 1U, last.count );
+	EXPECT_EQ( GPIO_VALUE_LOW, last.value );
+}
+
+TEST_F( GpioDispatcherTest, TestStormExactCountsEveryNotification ) {
+	GpioStormGuard::Counters counters;
+	uint64_t coalesced;
+	GpioEvent last = {};
+
+	sysfs.gpio( 22 );
+	if ( ! sysfs.pollable( 22 ) ) {
+		GTEST_SKIP();
+	}
+
+	storm_toggle( dispatcher, sysfs, true, counters, coalesced, last );
+
+	// a GPIO in a storm keeps being read, so (nearly) every level is counted
+	EXPECT_GE( counters.storms, 1U );
+	EXPECT_GE( counters.edges, 20U );
+	EXPECT_EQ( counters.coalesced, coalesced );
+	EXPECT_EQ( GPIO_VALUE_LOW, last.value );
+}
+
+TEST_F( GpioDispatcherTest, TestSlowExportDoesNotBlock ) {
+	std::chrono::steady_clock::time_point t0;
+	std::chrono::steady_clock::duration dt;
+	GpioDispatcher::Subscription s;
+	int actual_errno = EXIT_SUCCESS;
+	unsigned n = 0;
+
+	// nothing appears when GPIO 30 is exported, so subscribing waits out the export timeout
+	std::thread slow( [ this, & actual_errno ]() {
+		try {
+			dispatcher.subscribe( 30, GPIO_EDGE_BOTH, []( const GpioEvent & ) {} );
+		} catch( std::system_error &e ) {
+			actual_errno = e.code().value();
+		}
+	} );
+	std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+
+	t0 = std::chrono::steady_clock::now();
+	s = dispatcher.subscribe( 20, GPIO_EDGE_BOTH, [ & n ]( const GpioEvent & ) { n++; } );
+	dispatcher.inject( 20, GPIO_VALUE_HIGH );
+	dispatcher.unsubscribe( s );
+	dt = std::chrono::steady_clock::now() - t0;
+
+	slow.join();
+
+	EXPECT_LT( dt, std::chrono::milliseconds( 500 ) );
+	EXPECT_EQ( 1U, n );
+	EXPECT_NE( EXIT_SUCCESS, actual_errno );
+}
+
+TEST_F( GpioDispatcherTest, TestConcurrentFirstSubscribe ) {
+	const unsigned nthreads = 8;
+	std::vector<std::thread> threads;
+	std::atomic<unsigned> n( 0 );
+
+	for( unsigned i = 0; i < nthreads; i++ ) {
+		threads.push_back( std::thread( [ this, & n ]() {
+			dispatcher.subscribe( 20, GPIO_EDGE_BOTH, [ & n ]( const GpioEvent & ) { n++; } );
+		} ) );
+	}
+	for( auto & t: threads ) {
+		t.join();
+	}
+
+	dispatcher.inject( 20, GPIO_VALUE_HIGH );
+	EXPECT_EQ( nthreads, n );
+
+	// the setups that lost the race must not have unexported the GPIO
+	EXPECT_EQ( "", sysfs.read( "unexport" ) );
+}
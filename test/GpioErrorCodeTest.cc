@@ -0,0 +1,115 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "libgpio/Gpio.h"
+
+#include "FakeSysfs.h"
+
+using namespace ::std;
+using namespace ::com::github::cfriedt;
+
+class GpioErrorCodeTest : public testing::Test
+{
+
+public:
+
+	FakeSysfs sysfs;
+
+	void SetUp();
+	void TearDown();
+};
+
+void GpioErrorCodeTest::SetUp() {
+	sysfs.gpio( 5, "in", "0" );
+}
+
+void GpioErrorCodeTest::TearDown() {
+}
+
+TEST_F( GpioErrorCodeTest, TestOutput ) {
+	std::error_code ec = std::make_error_code( std::errc::io_error );
+
+	Gpio gpio( 5, GPIO_VALUE_HIGH, ec );
+	ASSERT_FALSE( ec );
+	EXPECT_EQ( GPIO_VALUE_HIGH, gpio.value( ec ) );
+	EXPECT_FALSE( ec );
+
+	gpio.value( GPIO_VALUE_LOW, ec );
+	ASSERT_FALSE( ec );
+	EXPECT_EQ( GPIO_VALUE_LOW, gpio.value( ec ) );
+	EXPECT_FALSE( ec );
+	EXPECT_EQ( GPIO_DIR_OUT, gpio.direction( ec ) );
+	EXPECT_FALSE( ec );
+}
+
+TEST_F( GpioErrorCodeTest, TestInput ) {
+	std::error_code ec;
+
+	Gpio gpio( 5, GPIO_EDGE_RISING, ec );
+	ASSERT_FALSE( ec );
+	EXPECT_EQ( GPIO_DIR_IN, gpio.direction( ec ) );
+	EXPECT_FALSE( ec );
+	EXPECT_EQ( GPIO_EDGE_RISING, gpio.edge( ec ) );
+	EXPECT_FALSE( ec );
+}
+
+TEST_F( GpioErrorCodeTest, TestFailureDoesNotThrow ) {
+	std::error_code ec;
+
+	Gpio gpio( 5, ec );
+	ASSERT_FALSE( ec );
+
+	ASSERT_EQ( 0, unlink( sysfs.path( "gpio5/value" ).c_str() ) );
+
+	EXPECT_NO_THROW( gpio.value( ec ) );
+	EXPECT_EQ( std::errc::no_such_file_or_directory, ec );
+
+	EXPECT_NO_THROW( gpio.value( GPIO_VALUE_HIGH, ec ) );
+	EXPECT_TRUE( ec );
+
+	EXPECT_THROW( gpio.value(), std::system_error );
+}
+
+TEST_F( GpioErrorCodeTest, TestWaitTimeout ) {
+	std::error_code ec;
+
+	Gpio gpio( 5, GPIO_EDGE_BOTH, ec );
+	ASSERT_FALSE( ec );
+
+	// plain files never raise POLLPRI
+	EXPECT_NO_THROW( gpio.wait( 5, ec ) );
+	EXPECT_EQ( std::errc::timed_out, ec );
+
+	try {
+		gpio.wait( 5 );
+		FAIL();
+	} catch( const std::system_error &e ) {
+		EXPECT_EQ( std::errc::timed_out, e.code() );
+	}
+}
@@ -0,0 +1,129 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <errno.h>
+
+#include <chrono>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "libgpio/Gpio.h"
+
+#include "FakeSysfs.h"
+
+using namespace ::std;
+using namespace ::com::github::cfriedt;
+
+class GpioExportTest : public testing::Test
+{
+
+public:
+
+	FakeSysfs sysfs;
+};
+
+TEST_F( GpioExportTest, TestAlreadyExported ) {
+	uint16_t gpio[] = { 3, 4, 5 };
+	int err[] = { -1, -1, -1 };
+
+	sysfs.gpio( 3 );
+	sysfs.gpio( 4 );
+	sysfs.gpio( 5 );
+
+	EXPECT_EQ( EXIT_SUCCESS, gpio_export_bulk( gpio, 3, 0, err ) );
+	EXPECT_EQ( EXIT_SUCCESS, err[ 0 ] );
+	EXPECT_EQ( EXIT_SUCCESS, err[ 1 ] );
+	EXPECT_EQ( EXIT_SUCCESS, err[ 2 ] );
+	EXPECT_EQ( "", sysfs.read( "export" ) );
+}
+
+TEST_F( GpioExportTest, TestPerPinTimeout ) {
+	uint16_t gpio[] = { 3, 4 };
+	int err[] = { -1, -1 };
+
+	sysfs.gpio( 3 );
+
+	errno = 0;
+	EXPECT_EQ( -1, gpio_export_bulk( gpio, 2, 50, err ) );
+	EXPECT_EQ( ETIMEDOUT, errno );
+	EXPECT_EQ( EXIT_SUCCESS, err[ 0 ] );
+	EXPECT_EQ( ETIMEDOUT, err[ 1 ] );
+	EXPECT_EQ( "4", sysfs.read( "export" ) );
+}
+
+TEST_F( GpioExportTest, TestWaitsForReadiness ) {
+	std::vector<uint16_t> gpio = { 7, 8 };
+	std::vector<std::error_code> ec;
+	std::chrono::steady_clock::time_point start;
+
+	sysfs.gpio( 8 );
+
+	std::thread udev( [ this ]() {
+		std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+		sysfs.gpio( 7 );
+	} );
+
+	start = std::chrono::steady_clock::now();
+	ec = Gpio::export_all( gpio, 10000 );
+	udev.join();
+
+	EXPECT_LT( std::chrono::steady_clock::now() - start, std::chrono::seconds( 5 ) );
+	ASSERT_EQ( 2U, ec.size() );
+	EXPECT_FALSE( ec[ 0 ] );
+	EXPECT_FALSE( ec[ 1 ] );
+}
+
+TEST_F( GpioExportTest, TestUnwritableExport ) {
+	std::vector<uint16_t> gpio = { 7, 8 };
+	std::vector<std::error_code> ec;
+
+	// a directory cannot be opened for writing, even by root
+	ASSERT_EQ( 0, unlink( sysfs.path( "export" ).c_str() ) );
+	sysfs.mkdir( "export" );
+
+	ec = Gpio::export_all( gpio, 50 );
+	ASSERT_EQ( 2U, ec.size() );
+	EXPECT_EQ( std::errc::is_a_directory, ec[ 0 ] );
+	EXPECT_EQ( std::errc::is_a_directory, ec[ 1 ] );
+}
+
+TEST_F( GpioExportTest, TestMissingExport ) {
+	uint16_t gpio[] = { 7, 8 };
+	int err[] = { 0, 0 };
+	std::vector<std::error_code> ec;
+
+	ASSERT_EQ( 0, unlink( sysfs.path( "export" ).c_str() ) );
+
+	errno = 0;
+	EXPECT_EQ( -1, gpio_export_bulk( gpio, 2, 50, err ) );
+	EXPECT_EQ( ENOENT, errno );
+	EXPECT_EQ( ENOENT, err[ 0 ] );
+	EXPECT_EQ( ENOENT, err[ 1 ] );
+
+	ec = Gpio::export_all( { 7, 8 }, 50 );
+	ASSERT_EQ( 2U, ec.size() );
+	EXPECT_TRUE( ec[ 0 ] );
+	EXPECT_TRUE( ec[ 1 ] );
+}
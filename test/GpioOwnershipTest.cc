@@ -0,0 +1,130 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <chrono>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "libgpio/Gpio.h"
+
+#include "FakeSysfs.h"
+
+using namespace ::std;
+using namespace ::com::github::cfriedt;
+
+class GpioOwnershipTest : public testing::Test
+{
+
+public:
+
+	FakeSysfs sysfs;
+
+	// backdate the attributes of a GPIO, so that writes show up as a newer mtime
+	void age( unsigned num ) {
+		const struct timespec times[ 2 ] = { { 0, 0 }, { 0, 0 } };
+		for( auto & attr: { "direction", "value", "edge" } ) {
+			ASSERT_EQ( 0, utimensat( AT_FDCWD, sysfs.path( "gpio" + std::to_string( num ) + "/" + attr ).c_str(), times, 0 ) );
+		}
+	}
+	bool written( unsigned num, const std::string &attr ) {
+		struct stat st;
+		EXPECT_EQ( 0, stat( sysfs.path( "gpio" + std::to_string( num ) + "/" + attr ).c_str(), & st ) );
+		return 0 != st.st_mtime;
+	}
+};
+
+TEST_F( GpioOwnershipTest, TestUnexportOnDestroy ) {
+	sysfs.gpio( 5 );
+	{
+		Gpio gpio( 5 );
+		EXPECT_EQ( Gpio::UNEXPORT_ON_DESTROY, gpio.ownership() );
+		EXPECT_FALSE( gpio.exported_here() );
+	}
+	EXPECT_EQ( "5", sysfs.read( "unexport" ) );
+}
+
+TEST_F( GpioOwnershipTest, TestLeaveExported ) {
+	sysfs.gpio( 5 );
+	{
+		Gpio gpio( 5, Gpio::LEAVE_EXPORTED );
+	}
+	EXPECT_EQ( "", sysfs.read( "unexport" ) );
+}
+
+TEST_F( GpioOwnershipTest, TestUnexportIfExportedHere ) {
+	sysfs.gpio( 5 );
+	{
+		Gpio gpio( 5, Gpio::UNEXPORT_IF_EXPORTED_HERE );
+	}
+	EXPECT_EQ( "", sysfs.read( "unexport" ) );
+
+	std::thread udev( [ this ]() {
+		std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+		sysfs.gpio( 7 );
+	} );
+	{
+		Gpio gpio( 7, Gpio::UNEXPORT_IF_EXPORTED_HERE );
+		udev.join();
+		EXPECT_TRUE( gpio.exported_here() );
+		EXPECT_EQ( "7", sysfs.read( "export" ) );
+	}
+	EXPECT_EQ( "7", sysfs.read( "unexport" ) );
+}
+
+TEST_F( GpioOwnershipTest, TestWarmRestartSkipsWrites ) {
+	sysfs.gpio( 5, "out", "1" );
+	sysfs.gpio( 6, "in", "0", "both" );
+	age( 5 );
+	age( 6 );
+
+	Gpio out( 5, GPIO_VALUE_HIGH, Gpio::LEAVE_EXPORTED );
+	Gpio in( 6, GPIO_EDGE_BOTH, Gpio::LEAVE_EXPORTED );
+
+	EXPECT_FALSE( written( 5, "direction" ) );
+	EXPECT_FALSE( written( 5, "value" ) );
+	EXPECT_FALSE( written( 6, "direction" ) );
+	EXPECT_FALSE( written( 6, "edge" ) );
+}
+
+TEST_F( GpioOwnershipTest, TestMismatchIsRewritten ) {
+	sysfs.gpio( 5, "out", "0" );
+	sysfs.gpio( 6, "in", "0", "none" );
+	age( 5 );
+	age( 6 );
+
+	Gpio out( 5, GPIO_VALUE_HIGH, Gpio::LEAVE_EXPORTED );
+	Gpio in( 6, GPIO_EDGE_RISING, Gpio::LEAVE_EXPORTED );
+
+	EXPECT_FALSE( written( 5, "direction" ) );
+	EXPECT_TRUE( written( 5, "value" ) );
+	EXPECT_EQ( GPIO_VALUE_HIGH, out.value() );
+	EXPECT_FALSE( written( 6, "direction" ) );
+	EXPECT_TRUE( written( 6, "edge" ) );
+	EXPECT_EQ( GPIO_EDGE_RISING, in.edge() );
+}
@@ -0,0 +1,178 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include <atomic>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "libgpio/GpioPulseCounter.h"
+
+#include "FakeSysfs.h"
+
+using namespace ::std;
+using namespace ::com::github::cfriedt;
+
+class GpioPulseCounterTest : public testing::Test
+{
+
+public:
+
+	GpioPulseCounter::time_point t0;
+	GpioPulseCounter counter;
+
+	GpioPulseCounterTest();
+
+	GpioPulseCounter::time_point at( unsigned us ) {
+		return t0 + std::chrono::microseconds( us );
+	}
+
+	void edge( gpio_value_t value, unsigned us ) {
+		GpioEvent event;
+		event.num = 0;
+		event.value = value;
+		event.edge = GPIO_VALUE_HIGH == value ? GPIO_EDGE_RISING : GPIO_EDGE_FALLING;
+		event.timestamp = at( us );
+		event.count = 1;
+		counter.edge( event );
+	}
+
+	// a 1 kHz square wave with 25% duty cycle
+	void square( unsigned periods ) {
+		for( unsigned i = 0; i < periods; i++ ) {
+			edge( GPIO_VALUE_HIGH, i * 1000 );
+			edge( GPIO_VALUE_LOW, i * 1000 + 250 );
+		}
+	}
+};
+
+GpioPulseCounterTest::GpioPulseCounterTest()
+:
+	t0( std::chrono::steady_clock::now() ),
+	counter( std::chrono::milliseconds( 10 ) )
+{
+}
+
+TEST_F( GpioPulseCounterTest, TestEmpty ) {
+	GpioPulseStats stats = counter.stats( at( 0 ) );
+	EXPECT_EQ( 0U, stats.rising );
+	EXPECT_EQ( 0U, stats.cycles );
+	EXPECT_EQ( 0, stats.frequency );
+}
+
+TEST_F( GpioPulseCounterTest, TestSquareWave ) {
+	GpioPulseStats stats;
+
+	square( 5 );
+	stats = counter.stats( at( 4250 ) );
+
+	EXPECT_EQ( 5U, stats.rising );
+	EXPECT_EQ( 5U, stats.falling );
+	EXPECT_EQ( 4U, stats.cycles );
+	EXPECT_DOUBLE_EQ( 1000, stats.frequency );
+	EXPECT_EQ( std::chrono::nanoseconds( std::chrono::milliseconds( 1 ) ), stats.period );
+	EXPECT_DOUBLE_EQ( 0.25, stats.duty_cycle );
+	EXPECT_EQ( std::chrono::nanoseconds( std::chrono::microseconds( 250 ) ), stats.high );
+	EXPECT_EQ( std::chrono::nanoseconds( std::chrono::microseconds( 750 ) ), stats.low );
+}
+
+TEST_F( GpioPulseCounterTest, TestRollingWindow ) {
+	GpioPulseStats stats;
+
+	square( 100 );
+	stats = counter.stats( at( 99250 ) );
+
+	// counts are cumulative, timing only covers cycles started in the last 10 ms
+	EXPECT_EQ( 100U, stats.rising );
+	EXPECT_EQ( 9U, stats.cycles );
+	EXPECT_DOUBLE_EQ( 1000, stats.frequency );
+
+	stats = counter.stats( at( 200000 ) );
+	EXPECT_EQ( 0U, stats.cycles );
+	EXPECT_EQ( 0, stats.frequency );
+}
+
+TEST_F( GpioPulseCounterTest, TestCoalescedBreaksCycle ) {
+	GpioEvent event;
+	GpioPulseStats stats;
+
+	edge( GPIO_VALUE_HIGH, 0 );
+	edge( GPIO_VALUE_LOW, 250 );
+
+	event.num = 0;
+	event.value = GPIO_VALUE_LOW;
+	event.edge = GPIO_EDGE_BOTH;
+	event.timestamp = at( 500 );
+	event.count = 7;
+	counter.edge( event );
+
+	edge( GPIO_VALUE_HIGH, 1000 );
+	stats = counter.stats( at( 1000 ) );
+
+	EXPECT_EQ( 7U, stats.untimed );
+	EXPECT_EQ( 0U, stats.cycles );
+}
+
+TEST( GpioPulseCounterDispatcherTest, TestDestroyWhileEdgesArrive ) {
+	FakeSysfs sysfs;
+	GpioDispatcher dispatcher;
+	std::atomic<bool> stop( false );
+	std::thread toggler;
+	GpioPulseCounter *counter;
+	uint64_t edges = 0;
+
+	sysfs.gpio( 23 );
+	if ( ! sysfs.pollable( 23 ) ) {
+		GTEST_SKIP();
+	}
+
+	// holds each delivery up ahead of the counter, while the counter goes away
+	dispatcher.subscribe( 23, GPIO_EDGE_BOTH, []( const GpioEvent & ) {
+		std::this_thread::sleep_for( std::chrono::microseconds( 200 ) );
+	} );
+
+	toggler = std::thread( [ & sysfs, & stop ]() {
+		for( unsigned i = 0; ! stop; i++ ) {
+			sysfs.level( 0 == i % 2 ? "1" : "0" );
+		}
+	} );
+
+	for( unsigned i = 0; i < 200; i++ ) {
+		counter = new GpioPulseCounter( dispatcher, 23 );
+		std::this_thread::sleep_for( std::chrono::microseconds( 500 ) );
+		GpioPulseStats stats = counter->stats();
+		edges += stats.rising + stats.falling;
+		// scribble over the counter, so a late callback would trip over it
+		counter->~GpioPulseCounter();
+		memset( (void *) counter, 0xa5, sizeof( *counter ) );
+		::operator delete( counter );
+	}
+
+	stop = true;
+	toggler.join();
+
+	EXPECT_GT( edges, 0U );
+}
@@ -0,0 +1,167 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "libgpio/GpioRegisters.h"
+
+using namespace ::std;
+using namespace ::com::github::cfriedt;
+
+// a plain file stands in for the register block, so nothing reacts to stores
+class GpioRegistersTest : public testing::Test
+{
+
+public:
+
+	std::string path;
+	int fd;
+
+	void SetUp();
+	void TearDown();
+
+	uint32_t peek( uint32_t offset ) {
+		uint32_t v = 0;
+		EXPECT_EQ( (ssize_t) sizeof( v ), pread( fd, & v, sizeof( v ), offset ) );
+		return v;
+	}
+	void poke( uint32_t offset, uint32_t v ) {
+		EXPECT_EQ( (ssize_t) sizeof( v ), pwrite( fd, & v, sizeof( v ), offset ) );
+	}
+};
+
+void GpioRegistersTest::SetUp() {
+	char tmpl[] = "/tmp/libgpio-regs-XXXXXX";
+	fd = mkstemp( tmpl );
+	ASSERT_NE( -1, fd );
+	path = tmpl;
+	ASSERT_EQ( 0, ftruncate( fd, 4096 ) );
+}
+
+void GpioRegistersTest::TearDown() {
+	close( fd );
+	unlink( path.c_str() );
+}
+
+// one bank, level at 0x0, output at 0x4, 1-bit direction at 0x8 with 1 for output
+static const GpioRegisterLayout simple = {
+	"simple",
+	0x10,
+	32,
+	32,
+	0,
+	0x0,
+	0x4,
+	GpioRegisterLayout::NONE,
+	GpioRegisterLayout::NONE,
+	0x8,
+	1,
+	32,
+	0,
+	1,
+};
+
+TEST_F( GpioRegistersTest, TestBcm2835SetClear ) {
+	GpioRegisters regs( GpioRegisterLayout::bcm2835(), path );
+
+	GpioRegisterPin pin( regs, 17, GPIO_DIR_OUT );
+	// GPFSEL1, bits 21-23
+	EXPECT_EQ( 1u << 21, peek( 0x04 ) );
+	EXPECT_EQ( GPIO_DIR_OUT, pin.direction() );
+
+	pin.set();
+	EXPECT_EQ( 1u << 17, peek( 0x1c ) );
+	pin.value( GPIO_VALUE_LOW );
+	EXPECT_EQ( 1u << 17, peek( 0x28 ) );
+
+	GpioRegisterPin high( regs, 40, GPIO_DIR_IN );
+	EXPECT_EQ( GPIO_DIR_IN, high.direction() );
+	poke( 0x38, 1u << 8 );
+	EXPECT_EQ( GPIO_VALUE_HIGH, high.value() );
+	poke( 0x38, 0 );
+	EXPECT_EQ( GPIO_VALUE_LOW, high.value() );
+
+	EXPECT_THROW( GpioRegisterPin( regs, 54, GPIO_DIR_IN ), std::system_error );
+}
+
+TEST_F( GpioRegistersTest, TestBcm2835DirectionPreservesNeighbours ) {
+	GpioRegisters regs( GpioRegisterLayout::bcm2835(), path );
+
+	// GPIO 10 and 11 in alternate function 0 (100)
+	poke( 0x04, 4u << 0 | 4u << 3 );
+
+	regs.direction( 11, GPIO_DIR_OUT );
+	EXPECT_EQ( 4u << 0 | 1u << 3, peek( 0x04 ) );
+	EXPECT_EQ( GPIO_DIR_IN, regs.direction( 10 ) );
+	EXPECT_EQ( GPIO_DIR_OUT, regs.direction( 11 ) );
+}
+
+TEST_F( GpioRegistersTest, TestBcm2835Port ) {
+	GpioRegisters regs( GpioRegisterLayout::bcm2835(), path );
+	GpioRegisterPort port( regs, { 4, 40, 5 }, GPIO_DIR_OUT );
+
+	port.write( 0x5 );
+	// bit 0 -> gpio4 and bit 2 -> gpio5 in bank 0, bit 1 -> gpio40 in bank 1
+	EXPECT_EQ( 1u << 4 | 1u << 5, peek( 0x1c ) );
+	EXPECT_EQ( 0u, peek( 0x20 ) );
+	EXPECT_EQ( 0u, peek( 0x28 ) );
+	EXPECT_EQ( 1u << 8, peek( 0x2c ) );
+
+	poke( 0x34, 1u << 5 );
+	poke( 0x38, 1u << 8 );
+	EXPECT_EQ( 0x6u, port.read() );
+}
+
+TEST_F( GpioRegistersTest, TestReadModifyWrite ) {
+	GpioRegisters regs( simple, path );
+	GpioRegisterPort port( regs, { 0, 1, 2, 3 }, GPIO_DIR_OUT );
+
+	EXPECT_EQ( 0xfu, peek( 0x8 ) );
+
+	poke( 0x4, 0x80000000 );
+	port.write( 0xa );
+	EXPECT_EQ( 0x8000000au, peek( 0x4 ) );
+
+	regs.set( 0 );
+	regs.clear( 31 );
+	EXPECT_EQ( 0xbu, peek( 0x4 ) );
+
+	poke( 0x0, 0x3 );
+	EXPECT_EQ( 0x3u, port.read() );
+}
+
+TEST_F( GpioRegistersTest, TestBadLayout ) {
+	GpioRegisterLayout layout = simple;
+
+	layout.out = GpioRegisterLayout::NONE;
+	EXPECT_THROW( GpioRegisters( layout, path ), std::system_error );
+	EXPECT_THROW( GpioRegisters( simple, "/nonexistent/gpiomem" ), std::system_error );
+}
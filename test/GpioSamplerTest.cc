@@ -0,0 +1,213 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <errno.h>
+
+#include <sstream>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "libgpio/GpioSampler.h"
+
+#include "FakeSysfs.h"
+
+using namespace ::std;
+using namespace ::com::github::cfriedt;
+
+// ticks are injected directly, without the timer thread
+class TestableGpioSampler : public GpioSampler {
+
+public:
+	TestableGpioSampler( const std::vector<uint16_t> &nums, size_t samples, size_t chunks )
+	:
+		GpioSampler( nums, std::chrono::microseconds( 100 ), samples, chunks )
+	{
+	}
+	void inject( uint64_t expirations = 1 ) {
+		tick( expirations );
+	}
+	void flush() {
+		hand_off();
+	}
+};
+
+class GpioSamplerTest : public testing::Test
+{
+
+public:
+
+	FakeSysfs sysfs;
+
+	void SetUp();
+	void TearDown();
+
+	void level( uint16_t num, gpio_value_t value ) {
+		sysfs.file( "gpio" + std::to_string( num ) + "/value", GPIO_VALUE_HIGH == value ? "1\n" : "0\n" );
+	}
+};
+
+void GpioSamplerTest::SetUp() {
+	sysfs.gpio( 3 );
+	sysfs.gpio( 4 );
+	sysfs.gpio( 5 );
+}
+
+void GpioSamplerTest::TearDown() {
+}
+
+TEST_F( GpioSamplerTest, TestColumns ) {
+	const GpioSampleChunk *chunk;
+	TestableGpioSampler sampler( { 3, 4, 5 }, 100, 2 );
+
+	// gpio3 toggles every sample, gpio4 goes high at sample 70, gpio5 stays low
+	for( unsigned i = 0; i < 100; i++ ) {
+		level( 3, i & 1 ? GPIO_VALUE_HIGH : GPIO_VALUE_LOW );
+		level( 4, i >= 70 ? GPIO_VALUE_HIGH : GPIO_VALUE_LOW );
+		sampler.inject();
+	}
+
+	ASSERT_TRUE( sampler.pop( chunk, 0 ) );
+	EXPECT_EQ( 0u, chunk->tick );
+	EXPECT_EQ( 100u, chunk->count );
+	EXPECT_EQ( 2u, chunk->stride );
+
+	EXPECT_EQ( 0xaaaaaaaaaaaaaaaaull, chunk->column( 0 )[ 0 ] );
+	EXPECT_EQ( 0ull, chunk->column( 1 )[ 0 ] );
+	EXPECT_EQ( ( ( (uint64_t) 1 << 30 ) - 1 ) << 6, chunk->column( 1 )[ 1 ] );
+	EXPECT_EQ( 0ull, chunk->column( 2 )[ 0 ] | chunk->column( 2 )[ 1 ] );
+	EXPECT_EQ( GPIO_VALUE_LOW, chunk->level( 1, 69 ) );
+	EXPECT_EQ( GPIO_VALUE_HIGH, chunk->level( 1, 70 ) );
+
+	sampler.release( chunk );
+	EXPECT_EQ( 100u, sampler.counters().samples );
+}
+
+TEST_F( GpioSamplerTest, TestMissedTicks ) {
+	const GpioSampleChunk *chunk;
+	GpioSampler::Counters counters;
+	TestableGpioSampler sampler( { 3 }, 64, 4 );
+
+	sampler.inject();
+	sampler.inject();
+	sampler.inject( 4 );
+	sampler.inject();
+	sampler.flush();
+
+	counters = sampler.counters();
+	EXPECT_EQ( 7u, counters.ticks );
+	EXPECT_EQ( 4u, counters.samples );
+	EXPECT_EQ( 3u, counters.missed );
+
+	ASSERT_TRUE( sampler.pop( chunk, 0 ) );
+	EXPECT_EQ( 0u, chunk->tick );
+	EXPECT_EQ( 2u, chunk->count );
+	sampler.release( chunk );
+
+	ASSERT_TRUE( sampler.pop( chunk, 0 ) );
+	EXPECT_EQ( 5u, chunk->tick );
+	EXPECT_EQ( 2u, chunk->count );
+	sampler.release( chunk );
+
+	EXPECT_FALSE( sampler.pop( chunk, 0 ) );
+}
+
+TEST_F( GpioSamplerTest, TestOverrun ) {
+	const GpioSampleChunk *chunk;
+	TestableGpioSampler sampler( { 3 }, 1, 1 );
+
+	sampler.inject();
+	sampler.inject();
+	EXPECT_EQ( 1u, sampler.counters().overruns );
+
+	ASSERT_TRUE( sampler.pop( chunk, 0 ) );
+	sampler.release( chunk );
+
+	sampler.inject();
+	ASSERT_TRUE( sampler.pop( chunk, 0 ) );
+	EXPECT_EQ( 2u, chunk->tick );
+	sampler.release( chunk );
+}
+
+TEST_F( GpioSamplerTest, TestVcd ) {
+	const GpioSampleChunk *chunk;
+	std::stringstream ss;
+	TestableGpioSampler sampler( { 3, 4 }, 100, 2 );
+	GpioVcdWriter vcd( ss, sampler.nums(), sampler.period() );
+
+	level( 3, GPIO_VALUE_HIGH );
+	sampler.inject();
+	sampler.inject();
+	level( 4, GPIO_VALUE_HIGH );
+	sampler.inject();
+	level( 3, GPIO_VALUE_LOW );
+	sampler.inject( 2 );
+	sampler.flush();
+
+	while( sampler.pop( chunk, 0 ) ) {
+		vcd.write( *chunk );
+		sampler.release( chunk );
+	}
+
+	EXPECT_EQ(
+		"$version libgpio $end\n"
+		"$timescale 1ns $end\n"
+		"$scope module gpio $end\n"
+		"$var wire 1 ! gpio3 $end\n"
+		"$var wire 1 \" gpio4 $end\n"
+		"$upscope $end\n"
+		"$enddefinitions $end\n"
+		"#0\n"
+		"1!\n"
+		"0\"\n"
+		"#200000\n"
+		"1\"\n"
+		"#400000\n"
+		"0!\n",
+		ss.str()
+	);
+}
+
+TEST_F( GpioSamplerTest, TestTimer ) {
+	const GpioSampleChunk *chunk;
+	GpioSampler::Counters counters;
+	size_t samples;
+	GpioSampler sampler( { 3, 4, 5 }, std::chrono::milliseconds( 1 ), 8, 64 );
+
+	sampler.start();
+	std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+	sampler.stop();
+
+	samples = 0;
+	while( sampler.pop( chunk, 0 ) ) {
+		samples += chunk->count;
+		sampler.release( chunk );
+	}
+
+	counters = sampler.counters();
+	EXPECT_GE( counters.ticks, 10u );
+	EXPECT_EQ( counters.ticks, counters.samples + counters.missed + counters.overruns );
+	EXPECT_EQ( counters.samples, samples );
+	EXPECT_EQ( 0u, counters.errors );
+}
@@ -0,0 +1,106 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include "libgpio/GpioStormGuard.h"
+
+using namespace ::std;
+using namespace ::com::github::cfriedt;
+
+class GpioStormGuardTest : public testing::Test
+{
+
+public:
+
+	GpioStormGuard::time_point t0;
+	GpioStormGuard guard;
+
+	GpioStormGuardTest();
+
+	GpioStormGuard::time_point at( unsigned ms ) {
+		return t0 + std::chrono::milliseconds( ms );
+	}
+};
+
+GpioStormGuardTest::GpioStormGuardTest()
+:
+	t0( std::chrono::steady_clock::now() ),
+	// more than 100 edges per second, measured over 100 ms, coalesced every 50 ms
+	guard( GpioStormGuard::Config( 100, std::chrono::milliseconds( 100 ), std::chrono::milliseconds( 50 ) ) )
+{
+}
+
+TEST_F( GpioStormGuardTest, TestDisabled ) {
+	GpioStormGuard disabled;
+
+	for( unsigned i = 0; i < 1000; i++ ) {
+		EXPECT_TRUE( disabled.edge( at( 0 ) ) );
+	}
+	EXPECT_FALSE( disabled.storming() );
+	EXPECT_EQ( 1000U, disabled.counters().edges );
+}
+
+TEST_F( GpioStormGuardTest, TestBelowThreshold ) {
+	// 10 edges per 100 ms is exactly at the threshold
+	for( unsigned i = 0; i < 100; i++ ) {
+		EXPECT_TRUE( guard.edge( at( i * 10 ) ) );
+	}
+	EXPECT_FALSE( guard.storming() );
+	EXPECT_EQ( 0U, guard.counters().storms );
+}
+
+TEST_F( GpioStormGuardTest, TestStormAndRecovery ) {
+	unsigned i;
+
+	for( i = 0; i < 10; i++ ) {
+		EXPECT_TRUE( guard.edge( at( i ) ) );
+	}
+	EXPECT_FALSE( guard.storming() );
+
+	// the 11th edge within the window starts the storm but is delivered
+	EXPECT_TRUE( guard.edge( at( 10 ) ) );
+	EXPECT_TRUE( guard.storming() );
+	EXPECT_EQ( 1U, guard.counters().storms );
+	EXPECT_EQ( at( 60 ), guard.holdoff() );
+
+	EXPECT_FALSE( guard.edge( at( 11 ) ) );
+	EXPECT_FALSE( guard.edge( at( 12 ) ) );
+	EXPECT_FALSE( guard.edge( at( 13 ) ) );
+
+	EXPECT_EQ( 3U, guard.flush( at( 60 ) ) );
+	EXPECT_TRUE( guard.storming() );
+	EXPECT_EQ( at( 110 ), guard.holdoff() );
+
+	EXPECT_FALSE( guard.edge( at( 70 ) ) );
+	EXPECT_EQ( 1U, guard.flush( at( 110 ) ) );
+
+	// a quiet interval ends the storm
+	EXPECT_EQ( 0U, guard.flush( at( 160 ) ) );
+	EXPECT_FALSE( guard.storming() );
+	EXPECT_TRUE( guard.edge( at( 170 ) ) );
+
+	EXPECT_EQ( 16U, guard.counters().edges );
+	EXPECT_EQ( 4U, guard.counters().coalesced );
+}
@@ -0,0 +1,217 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "libgpio/libgpio.h"
+#include "libgpio/gpiotrace.h"
+
+#include "FakeSysfs.h"
+
+using namespace ::std;
+using namespace ::com::github::cfriedt;
+
+class GpioTraceTest : public testing::Test
+{
+
+public:
+
+	FakeSysfs sysfs;
+	string bin;
+	string json;
+
+	void SetUp();
+	void TearDown();
+
+	off_t size() {
+		struct stat st;
+		if ( -1 == stat( bin.c_str(), & st ) ) {
+			return -1;
+		}
+		return st.st_size;
+	}
+	vector<gpio_trace_event_t> events() {
+		vector<gpio_trace_event_t> r;
+		gpio_trace_event_t ev;
+		ifstream f( bin, ios::binary );
+		f.seekg( sizeof( gpio_trace_header_t ) );
+		while( f.read( (char *) & ev, sizeof( ev ) ) ) {
+			r.push_back( ev );
+		}
+		return r;
+	}
+};
+
+void GpioTraceTest::SetUp() {
+	sysfs.gpio( 10, "in", "0" );
+	bin = sysfs.path( "trace.bin" );
+	json = sysfs.path( "trace.json" );
+}
+
+void GpioTraceTest::TearDown() {
+	if ( GPIO_TRACE_ENABLED() ) {
+		gpio_trace_stop();
+	}
+}
+
+TEST_F( GpioTraceTest, TestDisabledRecordsNothing ) {
+	gpio_value_t value;
+
+	ASSERT_EQ( EXIT_SUCCESS, gpio_value_get( 10, & value ) );
+
+	ASSERT_EQ( EXIT_SUCCESS, gpio_trace_start( bin.c_str() ) );
+	ASSERT_EQ( EXIT_SUCCESS, gpio_trace_stop() );
+	EXPECT_EQ( (off_t) sizeof( gpio_trace_header_t ), size() );
+
+	ASSERT_EQ( EXIT_SUCCESS, gpio_value_get( 10, & value ) );
+	EXPECT_EQ( (off_t) sizeof( gpio_trace_header_t ), size() );
+}
+
+TEST_F( GpioTraceTest, TestStartTwice ) {
+	ASSERT_EQ( EXIT_SUCCESS, gpio_trace_start( bin.c_str() ) );
+	errno = 0;
+	EXPECT_EQ( -1, gpio_trace_start( bin.c_str() ) );
+	EXPECT_EQ( EBUSY, errno );
+	ASSERT_EQ( EXIT_SUCCESS, gpio_trace_stop() );
+}
+
+TEST_F( GpioTraceTest, TestFailurePreservesErrno ) {
+	gpio_value_t value;
+	vector<gpio_trace_event_t> ev;
+
+	ASSERT_EQ( EXIT_SUCCESS, gpio_trace_start( bin.c_str() ) );
+	errno = 0;
+	EXPECT_EQ( -1, gpio_value_get( 99, & value ) );
+	EXPECT_EQ( ENOENT, errno );
+	ASSERT_EQ( EXIT_SUCCESS, gpio_trace_stop() );
+
+	ev = events();
+	ASSERT_EQ( 1u, ev.size() );
+	EXPECT_EQ( GPIO_TRACE_OP_PROP_GET, ev[ 0 ].op );
+	EXPECT_EQ( 99, ev[ 0 ].gpio );
+	EXPECT_EQ( GPIO_PROP_VALUE, ev[ 0 ].arg[ 0 ] );
+	EXPECT_EQ( ENOENT, ev[ 0 ].err );
+	EXPECT_LE( ev[ 0 ].start_ns, ev[ 0 ].end_ns );
+}
+
+TEST_F( GpioTraceTest, TestStopReportsLostEvents ) {
+	gpio_value_t value;
+	struct rlimit old;
+	struct rlimit lim;
+	void ( *handler )( int );
+	int r;
+	int err;
+
+	ASSERT_EQ( EXIT_SUCCESS, gpio_trace_start( bin.c_str() ) );
+	ASSERT_EQ( EXIT_SUCCESS, gpio_value_get( 10, & value ) );
+
+	// the trace file may not grow past its header
+	ASSERT_EQ( EXIT_SUCCESS, getrlimit( RLIMIT_FSIZE, & old ) );
+	lim = old;
+	lim.rlim_cur = sizeof( gpio_trace_header_t );
+	handler = signal( SIGXFSZ, SIG_IGN );
+	setrlimit( RLIMIT_FSIZE, & lim );
+	errno = 0;
+	r = gpio_trace_stop();
+	err = errno;
+	setrlimit( RLIMIT_FSIZE, & old );
+	signal( SIGXFSZ, handler );
+
+	EXPECT_EQ( -1, r );
+	EXPECT_EQ( EFBIG, err );
+
+	// stopped regardless
+	EXPECT_FALSE( GPIO_TRACE_ENABLED() );
+	ASSERT_EQ( EXIT_SUCCESS, gpio_trace_start( bin.c_str() ) );
+	EXPECT_EQ( EXIT_SUCCESS, gpio_trace_stop() );
+}
+
+TEST_F( GpioTraceTest, TestWaitTimeoutUnits ) {
+	gpio_trace_header_t hdr;
+	gpio_trace_event_t ev;
+
+	for( uint32_t version = 1; version <= GPIO_TRACE_VERSION; version++ ) {
+		stringstream ss;
+
+		memset( & hdr, 0, sizeof( hdr ) );
+		memcpy( hdr.magic, GPIO_TRACE_MAGIC, sizeof( GPIO_TRACE_MAGIC ) );
+		hdr.version = version;
+		hdr.event_size = sizeof( ev );
+		memset( & ev, 0, sizeof( ev ) );
+		ev.op = GPIO_TRACE_OP_WAIT;
+		ev.gpio = 10;
+		ev.arg[ 0 ] = 5;
+		{
+			ofstream f( bin, ios::binary | ios::trunc );
+			f.write( (const char *) & hdr, sizeof( hdr ) );
+			f.write( (const char *) & ev, sizeof( ev ) );
+		}
+
+		ASSERT_EQ( 1, gpio_trace_to_json( bin.c_str(), json.c_str() ) );
+		ss << ifstream( json ).rdbuf();
+		EXPECT_NE( string::npos, ss.str().find( 1 == version ? "\"timeout_ms\":5" : "\"timeout_us\":5" ) ) << ss.str();
+	}
+}
+
+TEST_F( GpioTraceTest, TestThreadsToJson ) {
+	const unsigned nthreads = 4;
+	const unsigned nops = 300;
+	vector<thread> threads;
+	stringstream ss;
+
+	ASSERT_EQ( EXIT_SUCCESS, gpio_trace_start( bin.c_str() ) );
+	for( unsigned i = 0; i < nthreads; i++ ) {
+		threads.push_back( thread( [ nops ]() {
+			gpio_value_t value;
+			for( unsigned j = 0; j < nops; j++ ) {
+				gpio_value_get( 10, & value );
+			}
+		} ) );
+	}
+	for( auto & t: threads ) {
+		t.join();
+	}
+	ASSERT_EQ( EXIT_SUCCESS, gpio_trace_stop() );
+
+	EXPECT_EQ( (off_t)( sizeof( gpio_trace_header_t ) + nthreads * nops * sizeof( gpio_trace_event_t ) ), size() );
+
+	ASSERT_EQ( (int)( nthreads * nops ), gpio_trace_to_json( bin.c_str(), json.c_str() ) );
+	ss << ifstream( json ).rdbuf();
+	EXPECT_NE( string::npos, ss.str().find( "\"traceEvents\"" ) );
+	EXPECT_NE( string::npos, ss.str().find( "\"value_get\"" ) );
+	EXPECT_NE( string::npos, ss.str().find( "\"gpio\":10" ) );
+	EXPECT_NE( string::npos, ss.str().find( "\"prop\":0,\"value\":" ) );
+}
@@ -0,0 +1,192 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016, Christopher Friedt <chrisfriedt@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "libgpio/Gpio.h"
+
+#include "FakeSysfs.h"
+
+using namespace ::std;
+using namespace ::com::github::cfriedt;
+
+// plain files never raise POLLPRI, so the read after a wakeup is exercised directly
+class TestableGpio : public Gpio {
+
+public:
+	using Gpio::Gpio;
+
+	void wakeup( const std::string &path, std::chrono::steady_clock::time_point timestamp, GpioEvent &event, std::error_code &ec ) {
+		int fd = sys_class_gpio_gpio_n_value_fd;
+		sys_class_gpio_gpio_n_value_fd = open( path.c_str(), O_RDWR );
+		read_event( timestamp, event, ec );
+		close( sys_class_gpio_gpio_n_value_fd );
+		sys_class_gpio_gpio_n_value_fd = fd;
+	}
+};
+
+// plain files never raise POLLPRI, so every wait ends in a timeout or interrupt()
+class GpioWaitTest : public testing::Test
+{
+
+public:
+
+	FakeSysfs sysfs;
+
+	void SetUp();
+	void TearDown();
+};
+
+void GpioWaitTest::SetUp() {
+	sysfs.gpio( 5, "in", "0", "both" );
+}
+
+void GpioWaitTest::TearDown() {
+}
+
+TEST_F( GpioWaitTest, TestWaitForSubMillisecond ) {
+	std::error_code ec;
+	std::chrono::steady_clock::time_point start;
+
+	Gpio gpio( 5, GPIO_EDGE_BOTH );
+
+	start = std::chrono::steady_clock::now();
+	gpio.wait_for( std::chrono::microseconds( 300 ), ec );
+	EXPECT_EQ( std::errc::timed_out, ec );
+	EXPECT_GE( std::chrono::steady_clock::now() - start, std::chrono::microseconds( 300 ) );
+}
+
+TEST_F( GpioWaitTest, TestWaitUntil ) {
+	std::chrono::steady_clock::time_point deadline;
+
+	Gpio gpio( 5, GPIO_EDGE_BOTH );
+
+	deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( 5 );
+	try {
+		gpio.wait_until( deadline );
+		FAIL();
+	} catch( const std::system_error &e ) {
+		EXPECT_EQ( std::errc::timed_out, e.code() );
+	}
+	EXPECT_GE( std::chrono::steady_clock::now(), deadline );
+}
+
+TEST_F( GpioWaitTest, TestFixedRateDoesNotDrift ) {
+	const unsigned n = 20;
+	const std::chrono::milliseconds period( 2 );
+	std::error_code ec;
+	std::chrono::steady_clock::time_point start;
+	std::chrono::steady_clock::time_point deadline;
+
+	Gpio gpio( 5, GPIO_EDGE_BOTH );
+
+	start = std::chrono::steady_clock::now();
+	deadline = start;
+	for( unsigned i = 0; i < n; i++ ) {
+		deadline += period;
+		gpio.wait_until( deadline, ec );
+		ASSERT_EQ( std::errc::timed_out, ec );
+	}
+
+	// the overhead of each pass is absorbed by the next deadline
+	EXPECT_GE( std::chrono::steady_clock::now() - start, n * period );
+	EXPECT_LT( std::chrono::steady_clock::now() - start, n * period + std::chrono::milliseconds( 50 ) );
+}
+
+TEST_F( GpioWaitTest, TestWaitForeverInterrupted ) {
+	std::error_code ec;
+	std::atomic<bool> done( false );
+	std::chrono::steady_clock::time_point start;
+
+	Gpio gpio( 5, GPIO_EDGE_BOTH );
+
+	start = std::chrono::steady_clock::now();
+	std::thread waiter( [ & ]() {
+		gpio.wait( ec );
+		done = true;
+	} );
+	std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+	while( ! done ) {
+		gpio.interrupt();
+		std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+	}
+	waiter.join();
+
+	EXPECT_EQ( std::errc::interrupted, ec );
+	EXPECT_GE( std::chrono::steady_clock::now() - start, std::chrono::milliseconds( 50 ) );
+}
+
+TEST_F( GpioWaitTest, TestEventTimeout ) {
+	std::error_code ec;
+	GpioEvent event;
+
+	Gpio gpio( 5, GPIO_EDGE_BOTH );
+
+	event.num = 0;
+	gpio.wait_for( std::chrono::milliseconds( 2 ), event, ec );
+	EXPECT_EQ( std::errc::timed_out, ec );
+	EXPECT_EQ( 0, event.num );
+
+	EXPECT_THROW( gpio.wait_until( std::chrono::steady_clock::now(), event ), std::system_error );
+}
+
+TEST_F( GpioWaitTest, TestEventLevel ) {
+	std::error_code ec;
+	GpioEvent event;
+	std::chrono::steady_clock::time_point now;
+
+	TestableGpio gpio( 5, GPIO_EDGE_BOTH );
+
+	now = std::chrono::steady_clock::now();
+	sysfs.file( "gpio5/value", "1\n" );
+	gpio.wakeup( sysfs.path( "gpio5/value" ), now, event, ec );
+	ASSERT_FALSE( ec );
+	EXPECT_EQ( 5, event.num );
+	EXPECT_EQ( GPIO_VALUE_HIGH, event.value );
+	EXPECT_EQ( GPIO_EDGE_RISING, event.edge );
+	EXPECT_EQ( now, event.timestamp );
+	EXPECT_EQ( 1u, event.count );
+}
+
+TEST_F( GpioWaitTest, TestEventConfiguredEdge ) {
+	std::error_code ec;
+	GpioEvent event;
+
+	TestableGpio gpio( 5, GPIO_EDGE_FALLING );
+
+	sysfs.file( "gpio5/value", "1\n" );
+	gpio.wakeup( sysfs.path( "gpio5/value" ), std::chrono::steady_clock::now(), event, ec );
+	ASSERT_FALSE( ec );
+	// the level may already have bounced back, but the edge is the one that was armed
+	EXPECT_EQ( GPIO_VALUE_HIGH, event.value );
+	EXPECT_EQ( GPIO_EDGE_FALLING, event.edge );
+}